@@ -0,0 +1,48 @@
+// Generated by `wordle4 calibrate 40 64`. Do not edit.
+// Expected guesses after the next one to solve n answers, by n.
+constexpr double EMBEDDED_LEAF_VALUES[] = {
+  0.000000,  // 0
+  0.000000,  // 1
+  0.500000,  // 2
+  0.723958,  // 3
+  0.839844,  // 4
+  0.893750,  // 5
+  0.929688,  // 6
+  0.968750,  // 7
+  0.984375,  // 8
+  1.039931,  // 9
+  1.051563,  // 10
+  1.072443,  // 11
+  1.100260,  // 12
+  1.104567,  // 13
+  1.147284,  // 14
+  1.147284,  // 15
+  1.160156,  // 16
+  1.187168,  // 17
+  1.187168,  // 18
+  1.207998,  // 19
+  1.207998,  // 20
+  1.218006,  // 21
+  1.253551,  // 22
+  1.267352,  // 23
+  1.267352,  // 24
+  1.276250,  // 25
+  1.286058,  // 26
+  1.286058,  // 27
+  1.293248,  // 28
+  1.293248,  // 29
+  1.308854,  // 30
+  1.309980,  // 31
+  1.321926,  // 32
+  1.321926,  // 33
+  1.321926,  // 34
+  1.342560,  // 35
+  1.342560,  // 36
+  1.356419,  // 37
+  1.369955,  // 38
+  1.369955,  // 39
+  1.373828,  // 40
+};
+// Past the table: intercept + slope * log(n).
+constexpr double LEAF_VALUE_INTERCEPT = 0.574070;
+constexpr double LEAF_VALUE_SLOPE = 0.216024;
@@ -0,0 +1,133 @@
+// Turns the word lists into wordle_tables.h, which wordle4.cc compiles
+// in so it doesn't have to read or index them at startup.
+//
+// Usage: make_tables <guesses file> <answers file> > wordle_tables.h
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+constexpr int WORD_LENGTH = 5;
+
+std::vector<std::string> load_file(const std::string& path) {
+  std::ifstream f(path);
+  if (!f) {
+    fprintf(stderr, "Can't read %s\n", path.c_str());
+    exit(1);
+  }
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(f, line)) {
+    if (line.size() != WORD_LENGTH) {
+      fprintf(stderr, "%s: bad word '%s'\n", path.c_str(), line.c_str());
+      exit(1);
+    }
+    for (char c : line) {
+      if (c < 'a' || c > 'z') {
+	fprintf(stderr, "%s: bad word '%s'\n", path.c_str(), line.c_str());
+	exit(1);
+      }
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+void print_words(const char* name, const std::vector<std::string>& words) {
+  printf("constexpr Word %s[] = {\n", name);
+  for (int i = 0; i < words.size(); i++) {
+    printf("%s{\"%s\"},", i % 8 == 0 ? "  " : " ", words[i].c_str());
+    if (i % 8 == 7 || i == words.size() - 1) {
+      printf("\n");
+    }
+  }
+  printf("};\n\n");
+}
+
+// The indices of words in alphabetical order, which wordle4.cc binary
+// searches to look words up.
+void print_order(const char* name, const std::vector<std::string>& words) {
+  std::vector<int> order(words.size());
+  for (int i = 0; i < words.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int left, int right) {
+    return words[left] < words[right];
+  });
+  printf("constexpr int %s[] = {\n", name);
+  for (int i = 0; i < order.size(); i++) {
+    printf("%s%d,", i % 8 == 0 ? "  " : " ", order[i]);
+    if (i % 8 == 7 || i == order.size() - 1) {
+      printf("\n");
+    }
+  }
+  printf("};\n\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <guesses file> <answers file>\n", argv[0]);
+    return 1;
+  }
+  const std::vector<std::string> guesses = load_file(argv[1]);
+  const std::vector<std::string> answers = load_file(argv[2]);
+
+  printf("// Generated by make_tables from %s and %s. Do not edit.\n", argv[1], argv[2]);
+  printf("// Included by wordle4.cc, which defines Word and LetterCounts.\n\n");
+  print_words("EMBEDDED_GUESSES", guesses);
+  print_words("EMBEDDED_ANSWERS", answers);
+  print_order("EMBEDDED_GUESSES_BY_WORD", guesses);
+  print_order("EMBEDDED_ANSWERS_BY_WORD", answers);
+
+  printf("constexpr LetterCounts EMBEDDED_ANSWER_LETTER_COUNTS[] = {\n");
+  for (const std::string& answer : answers) {
+    int counts[26] = {0};
+    for (char c : answer) {
+      counts[c - 'a']++;
+    }
+    printf("  {");
+    for (int i = 0; i < 26; i++) {
+      printf(i > 0 ? ",%d" : "%d", counts[i]);
+    }
+    printf("},\n");
+  }
+  printf("};\n\n");
+
+  printf("constexpr int EMBEDDED_GUESS_LETTER_MASKS[] = {\n");
+  for (int i = 0; i < guesses.size(); i++) {
+    int mask = 0;
+    for (char c : guesses[i]) {
+      mask |= 1 << (c - 'a');
+    }
+    printf("%s0x%07x,", i % 8 == 0 ? "  " : " ", mask);
+    if (i % 8 == 7 || i == guesses.size() - 1) {
+      printf("\n");
+    }
+  }
+  printf("};\n\n");
+
+  printf("// Guess index of each answer.\n");
+  printf("constexpr int EMBEDDED_ANSWER_GUESSES[] = {\n");
+  for (int i = 0; i < answers.size(); i++) {
+    int guess = -1;
+    for (int j = 0; j < guesses.size(); j++) {
+      if (guesses[j] == answers[i]) {
+	guess = j;
+	break;
+      }
+    }
+    if (guess < 0) {
+      fprintf(stderr, "Answer '%s' is not an allowed guess\n", answers[i].c_str());
+      return 1;
+    }
+    printf("%s%d,", i % 8 == 0 ? "  " : " ", guess);
+    if (i % 8 == 7 || i == answers.size() - 1) {
+      printf("\n");
+    }
+  }
+  printf("};\n");
+  return 0;
+}
@@ -1,76 +1,788 @@
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
 #include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <deque>
+#include <cstring>
+#include <ctime>
 #include <functional>
+#include <list>
+#include <map>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "wordlitzer.h"
+
 using Outcome = std::pair<int, int>;
-using LetterCounts = std::unordered_map<char, int>;
+using LetterCounts = std::array<unsigned char, 26>;
 
 constexpr int WORD_LENGTH = 5;
 constexpr int MAX_CANDIDATES = 100;
+// Times a task is handed to a new worker after the one running it
+// dies, before it is given up on; see run_sharded().
+constexpr int MAX_TASK_ATTEMPTS = 3;
 
-std::vector<std::string> GUESSES;
-std::vector<std::string> ANSWERS;
-std::vector<LetterCounts> ANSWER_LETTER_COUNTS;
+// Number of worker processes the root candidates are sharded
+// across, and of threads solve_mcts() grows its tree with. 0 evaluates
+// them in this process.
+int NUM_WORKERS = 0;
 
-// Mapping from GUESS_INDEX x ANSWER_INDEX -> COLOR_INDEX.
-std::vector<int> COLORS_CACHE;
+// Opener reorder_dictionary() lays the tables out around, if set by
+// --locality_order. Empty keeps the word lists' order.
+std::string LOCALITY_OPENER;
 
-long long CACHE_HITS = 0;
-long long CACHE_MISSES = 0;
+// Computes colors on the fly instead of caching them, so the
+// guess x answer matrix is never allocated.
+bool MATRIX_FREE = false;
 
-std::vector<std::string> load_file(const std::string& path) {
-  std::vector<std::string> lines;
+// File the colors are kept in, a tile at a time, instead of
+// COLORS_CACHE; see TileStore. Empty keeps them in memory.
+std::string TILE_STORE_PATH;
+// Memory the tile store may keep mapped at once.
+int TILE_CACHE_MB = 256;
+
+// Whether searches value the answers left at max_depth with the
+// calibrated leaf_value() instead of the shallow score.
+bool LEAF_ESTIMATOR = true;
+// Guesses tried at a leaf when estimating from leaf_value().
+constexpr int LEAF_CANDIDATES = 10;
+
+// Whether root searches print their progress. Per thread, like the rest
+// of a Solver's state, so one thread going quiet doesn't race another.
+thread_local bool VERBOSE = true;
+
+// Whether the root shallow pass uses successive halving; see
+// shallow_scores_halving().
+bool SUCCESSIVE_HALVING = false;
+// Smaller roots are cheap enough to score exactly.
+constexpr int HALVING_MIN_ANSWERS = 500;
+constexpr int HALVING_INITIAL_SAMPLE = 256;
+// Chance that a guess which belongs among the top MAX_CANDIDATES, or
+// in the worthwhile pool, is dropped anyway.
+constexpr double HALVING_FAILURE_PROBABILITY = 0.01;
+
+// Directory root searches are checkpointed to. Empty disables
+// checkpointing.
+std::string CHECKPOINT_DIR;
+
+// A read-only table that either points at data compiled into the
+// binary or owns data built at runtime.
+template <typename T>
+class Table {
+public:
+  Table() = default;
+  template <size_t N>
+  Table(const T (&data)[N]) : data_(data), size_(N) {}
+  explicit Table(std::vector<T> owned)
+    : owned_(std::move(owned)), data_(owned_.data()), size_(owned_.size()) {}
+  // A view of another table's data, which must outlive it.
+  Table(const T* data, size_t size) : data_(data), size_(size) {}
+  // Moving a vector keeps its buffer, so data_ stays valid.
+  Table(Table&&) = default;
+  Table& operator=(Table&&) = default;
+
+  const T& operator[](int i) const { return data_[i]; }
+  size_t size() const { return size_; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+
+private:
+  std::vector<T> owned_;
+  const T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+struct Word {
+  char letters[WORD_LENGTH + 1];
+
+  char operator[](int i) const { return letters[i]; }
+  const char* c_str() const { return letters; }
+  bool operator==(const std::string& other) const { return other == letters; }
+};
+
+#include "wordle_tables.h"
+#include "leaf_values.h"
+
+// The tables for one pair of word lists. Nothing changes one once it's
+// built except the colors cache, whose entries are filled in on first
+// use with atomic loads and stores, so any number of threads can share
+// a dictionary: threads that race on an entry store the same value.
+struct Dictionary {
+  Table<Word> guesses;
+  Table<Word> answers;
+  Table<LetterCounts> answer_letter_counts;
+  Table<int> guess_letter_masks;
+  Table<int> answer_guesses;
+  // Position in the word list of each guess and answer. Empty unless
+  // reorder_dictionary() laid them out in another order.
+  std::vector<int> guess_words;
+  std::vector<int> answer_words;
+  // Indices of guesses and answers in alphabetical order, which
+  // find_word() binary searches.
+  Table<int> guesses_by_word;
+  Table<int> answers_by_word;
+  // Guess x answer -> colors index, -1 until computed. Empty in
+  // matrix-free and tiled modes.
+  std::vector<int> colors_cache;
+  // A copy of colors_cache on each NUMA node, if replicated by
+  // replicate_colors_cache(). Shared with forked workers.
+  std::vector<std::shared_ptr<int>> colors_replicas;
+};
+
+// The engine's globals are thread_local: each thread searches with the
+// dictionary and state of the Solver bound to it, so searches on
+// different threads share nothing mutable. The tables below are views
+// of DICTIONARY, set by bind_dictionary().
+thread_local std::shared_ptr<Dictionary> DICTIONARY;
+thread_local Table<Word> GUESSES;
+thread_local Table<Word> ANSWERS;
+thread_local Table<LetterCounts> ANSWER_LETTER_COUNTS;
+// Bit (c - 'a') is set if the guess contains letter c.
+thread_local Table<int> GUESS_LETTER_MASKS;
+// Guess index of each answer.
+thread_local Table<int> ANSWER_GUESSES;
+// Mapping from GUESS_INDEX x ANSWER_INDEX -> COLOR_INDEX, or null when
+// colors aren't cached.
+thread_local int* COLORS_CACHE = nullptr;
+
+// With --numa, the CPUs of each NUMA node when there's more than one.
+// Forked workers and the threads of SearchScheduler and solve_mcts()
+// are dealt out across the nodes as they're made. Empty keeps one copy
+// of the tables and leaves threads where the OS puts them.
+std::vector<std::vector<int>> NUMA_NODES;
+// Node the thread was pinned to by enter_numa_node(), or -1. Its
+// COLORS_CACHE is that node's replica.
+thread_local int NUMA_NODE = -1;
+
+// Guesses searches choose from, if narrowed by --guess_pool; see
+// reduce_guesses(). Empty means all of GUESSES.
+thread_local std::vector<int> GUESS_POOL;
+
+// Expected number of guesses after the next one to solve n answers,
+// indexed by n. Calibrated offline by calibrate(), the only thing that
+// changes it, so it's shared.
+Table<double> LEAF_VALUES(EMBEDDED_LEAF_VALUES);
+
+thread_local long long CACHE_HITS = 0;
+thread_local long long CACHE_MISSES = 0;
+
+// Makes dictionary the calling thread's.
+void bind_dictionary(std::shared_ptr<Dictionary> dictionary) {
+  DICTIONARY = std::move(dictionary);
+  if (DICTIONARY == nullptr) {
+    GUESSES = Table<Word>();
+    ANSWERS = Table<Word>();
+    ANSWER_LETTER_COUNTS = Table<LetterCounts>();
+    GUESS_LETTER_MASKS = Table<int>();
+    ANSWER_GUESSES = Table<int>();
+    COLORS_CACHE = nullptr;
+    return;
+  }
+  const Dictionary& d = *DICTIONARY;
+  GUESSES = Table<Word>(d.guesses.begin(), d.guesses.size());
+  ANSWERS = Table<Word>(d.answers.begin(), d.answers.size());
+  ANSWER_LETTER_COUNTS = Table<LetterCounts>(d.answer_letter_counts.begin(),
+					     d.answer_letter_counts.size());
+  GUESS_LETTER_MASKS = Table<int>(d.guess_letter_masks.begin(), d.guess_letter_masks.size());
+  ANSWER_GUESSES = Table<int>(d.answer_guesses.begin(), d.answer_guesses.size());
+  COLORS_CACHE = d.colors_cache.empty() ? nullptr : DICTIONARY->colors_cache.data();
+  if (NUMA_NODE >= 0 && NUMA_NODE < d.colors_replicas.size()) {
+    COLORS_CACHE = d.colors_replicas[NUMA_NODE].get();
+  }
+}
+
+// Records where search time goes along each guess/pattern path, in the
+// collapsed stack format flamegraph.pl and similar tools read:
+//   root[83];plink;--+--[12];cloud 1234
+// Guess frames are the guess; pattern frames are the colors it got
+// and, in brackets, how many answers that leaves. Each line's count is
+// the stack's own time in microseconds, not counting its children.
+class Tracer {
+public:
+  void push(const std::string& frame) {
+    frames_.push_back({stack_.size(), std::chrono::steady_clock::now(), 0});
+    if (!stack_.empty()) {
+      stack_ += ';';
+    }
+    stack_ += frame;
+  }
+
+  void pop() {
+    const Frame& frame = frames_.back();
+    const long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - frame.start).count();
+    self_times_[stack_] += elapsed - frame.child_time;
+    stack_.resize(frame.prefix_length);
+    frames_.pop_back();
+    if (!frames_.empty()) {
+      frames_.back().child_time += elapsed;
+    }
+  }
+
+  void write(const std::string& path) const {
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+      perror(path.c_str());
+      return;
+    }
+    for (const auto& entry : self_times_) {
+      fprintf(f, "%s %lld\n", entry.first.c_str(), entry.second);
+    }
+    fclose(f);
+  }
+
+private:
+  struct Frame {
+    size_t prefix_length;
+    std::chrono::steady_clock::time_point start;
+    long long child_time;
+  };
+  std::string stack_;
+  std::vector<Frame> frames_;
+  std::map<std::string, long long> self_times_;
+};
+
+// Set by --trace. Searches only touch it behind a null check, so
+// tracing costs nothing when off. Workers don't report back to it.
+thread_local Tracer* TRACER = nullptr;
+
+// Five lowercase letters, which the letter tables are indexed by.
+bool valid_word(const std::string& word) {
+  return word.size() == WORD_LENGTH &&
+    std::all_of(word.begin(), word.end(), [](char c) { return c >= 'a' && c <= 'z'; });
+}
+
+// Reads a word list into words. Returns false and says why in error if
+// it can't be read or has a bad word.
+bool load_file(const std::string& path, std::vector<Word>* words, std::string* error) {
   std::ifstream f(path);
+  if (!f) {
+    *error = "Can't read " + path;
+    return false;
+  }
   std::string line;
   while (std::getline(f, line)) {
-    lines.push_back(line);
+    if (!valid_word(line)) {
+      *error = path + ": bad word '" + line + "'";
+      return false;
+    }
+    Word word;
+    line.copy(word.letters, WORD_LENGTH);
+    word.letters[WORD_LENGTH] = '\0';
+    words->push_back(word);
   }
-  return lines;
+  return true;
 }
 
-LetterCounts get_letter_counts(const std::string& word) {
-  LetterCounts counts;
-  for (char c : word) {
-    counts[c]++;
+LetterCounts get_letter_counts(const char* word) {
+  LetterCounts counts = {0};
+  for (const char* c = word; *c; c++) {
+    counts[*c - 'a']++;
   }
   return counts;
 }
 
+int get_letter_mask(const char* word) {
+  int mask = 0;
+  for (const char* c = word; *c; c++) {
+    mask |= 1 << (*c - 'a');
+  }
+  return mask;
+}
+
+// Allocates the colors cache unless colors are computed or tiled.
+void allocate_colors_cache(Dictionary* dictionary) {
+  if (!MATRIX_FREE && TILE_STORE_PATH.empty()) {
+    dictionary->colors_cache.assign(dictionary->guesses.size() * dictionary->answers.size(), -1);
+  }
+}
+
+// Parses a sysfs CPU list like "0-3,8-11".
+std::vector<int> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  size_t start = 0;
+  while (start < list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    int first, last;
+    const int fields = sscanf(list.substr(start, end - start).c_str(), "%d-%d", &first, &last);
+    if (fields == 1) {
+      last = first;
+    }
+    for (int cpu = first; fields >= 1 && cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+    start = end + 1;
+  }
+  return cpus;
+}
+
+// The CPUs of each NUMA node. Read from sysfs rather than libnuma so
+// there's nothing to link; empty if the kernel doesn't say.
+std::vector<std::vector<int>> read_numa_nodes() {
+  std::vector<std::vector<int>> nodes;
+  for (int node = 0;; node++) {
+    std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string line;
+    if (!f || !std::getline(f, line)) {
+      break;
+    }
+    nodes.push_back(parse_cpu_list(line));
+  }
+  return nodes;
+}
+
+bool pin_to_cpus(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+// Copies the dictionary's colors cache once per node. Each copy is
+// written from a CPU of its node, and since the kernel places a page
+// where it is first touched, it ends up in that node's memory. The
+// copies are shared mappings, so forked workers on one node fill in
+// entries for each other; entries filled in one copy are recomputed
+// in the others.
+void replicate_colors_cache(Dictionary* dictionary, const std::vector<std::vector<int>>& nodes) {
+  if (dictionary->colors_cache.empty()) {
+    return;
+  }
+  cpu_set_t original;
+  sched_getaffinity(0, sizeof(original), &original);
+  const size_t bytes = dictionary->colors_cache.size() * sizeof(int);
+  for (const std::vector<int>& cpus : nodes) {
+    if (!pin_to_cpus(cpus)) {
+      perror("sched_setaffinity");
+    }
+    void* replica = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+			 -1, 0);
+    if (replica == MAP_FAILED) {
+      perror("mmap");
+      exit(1);
+    }
+    memcpy(replica, dictionary->colors_cache.data(), bytes);
+    dictionary->colors_replicas.emplace_back(static_cast<int*>(replica), [bytes](int* replica) {
+      munmap(replica, bytes);
+    });
+  }
+  sched_setaffinity(0, sizeof(original), &original);
+}
+
+// Brings the dictionary's replicas up to date with each other and the
+// primary copy, so each has every entry any of them has filled in.
+void refresh_colors_replicas(Dictionary* dictionary) {
+  if (dictionary->colors_replicas.empty()) {
+    return;
+  }
+  int* primary = dictionary->colors_cache.data();
+  for (size_t i = 0; i < dictionary->colors_cache.size(); i++) {
+    for (const std::shared_ptr<int>& replica : dictionary->colors_replicas) {
+      if (primary[i] >= 0) {
+	break;
+      }
+      primary[i] = replica.get()[i];
+    }
+    if (primary[i] < 0) {
+      continue;
+    }
+    for (const std::shared_ptr<int>& replica : dictionary->colors_replicas) {
+      replica.get()[i] = primary[i];
+    }
+  }
+}
+
+// Pins the calling thread, or worker process, to NUMA node node (mod
+// the number of nodes) and has it read that node's replica. Does
+// nothing without --numa.
+void enter_numa_node(int node) {
+  if (NUMA_NODES.empty()) {
+    return;
+  }
+  NUMA_NODE = node % NUMA_NODES.size();
+  if (!pin_to_cpus(NUMA_NODES[NUMA_NODE])) {
+    perror("sched_setaffinity");
+  }
+  bind_dictionary(DICTIONARY);
+}
+
+// The indices of words in alphabetical order.
+Table<int> sort_words(const Table<Word>& words) {
+  std::vector<int> order(words.size());
+  for (int i = 0; i < words.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int left, int right) {
+    return strcmp(words[left].c_str(), words[right].c_str()) < 0;
+  });
+  return Table<int>(std::move(order));
+}
+
+// Fills in the dictionary's alphabetical orders from its word lists,
+// for dictionaries built at runtime.
+void index_words(Dictionary* dictionary) {
+  dictionary->guesses_by_word = sort_words(dictionary->guesses);
+  dictionary->answers_by_word = sort_words(dictionary->answers);
+}
+
+// Index of word in words, or -1 if it isn't one, by binary search of
+// by_word, their alphabetical order.
+int find_word(const Table<Word>& words, const Table<int>& by_word, const std::string& word) {
+  auto iter = std::lower_bound(by_word.begin(), by_word.end(), word,
+			       [&](int i, const std::string& word) {
+    return word.compare(words[i].c_str()) > 0;
+  });
+  return iter != by_word.end() && words[*iter] == word ? *iter : -1;
+}
+
+// The word lists and tables compiled in from wordle_tables.h.
+std::shared_ptr<Dictionary> embedded_dictionary() {
+  std::shared_ptr<Dictionary> dictionary(new Dictionary);
+  dictionary->guesses = Table<Word>(EMBEDDED_GUESSES);
+  dictionary->answers = Table<Word>(EMBEDDED_ANSWERS);
+  dictionary->answer_letter_counts = Table<LetterCounts>(EMBEDDED_ANSWER_LETTER_COUNTS);
+  dictionary->guess_letter_masks = Table<int>(EMBEDDED_GUESS_LETTER_MASKS);
+  dictionary->answer_guesses = Table<int>(EMBEDDED_ANSWER_GUESSES);
+  dictionary->guesses_by_word = Table<int>(EMBEDDED_GUESSES_BY_WORD);
+  dictionary->answers_by_word = Table<int>(EMBEDDED_ANSWERS_BY_WORD);
+  allocate_colors_cache(dictionary.get());
+  return dictionary;
+}
+
 void initialize_tables() {
+  bind_dictionary(embedded_dictionary());
+}
+
+// Builds the tables for word lists read from files, for dictionaries
+// other than the one compiled in. Returns null and says why in error if
+// the lists can't be read or don't fit together.
+std::shared_ptr<Dictionary> read_dictionary(const std::string& guesses_path,
+					    const std::string& answers_path,
+					    std::string* error) {
+  std::vector<Word> guesses;
+  std::vector<Word> answers;
+  if (!load_file(guesses_path, &guesses, error) || !load_file(answers_path, &answers, error)) {
+    return nullptr;
+  }
+  std::shared_ptr<Dictionary> dictionary(new Dictionary);
+  dictionary->guesses = Table<Word>(std::move(guesses));
+  dictionary->answers = Table<Word>(std::move(answers));
+  index_words(dictionary.get());
+  std::vector<LetterCounts> answer_letter_counts;
+  std::vector<int> answer_guesses;
+  for (const Word& answer : dictionary->answers) {
+    answer_letter_counts.push_back(get_letter_counts(answer.c_str()));
+    const int guess = find_word(dictionary->guesses, dictionary->guesses_by_word,
+				answer.c_str());
+    if (guess < 0) {
+      *error = std::string("Answer '") + answer.c_str() + "' is not an allowed guess";
+      return nullptr;
+    }
+    answer_guesses.push_back(guess);
+  }
+  std::vector<int> guess_letter_masks;
+  for (const Word& guess : dictionary->guesses) {
+    guess_letter_masks.push_back(get_letter_mask(guess.c_str()));
+  }
+  dictionary->answer_letter_counts = Table<LetterCounts>(std::move(answer_letter_counts));
+  dictionary->guess_letter_masks = Table<int>(std::move(guess_letter_masks));
+  dictionary->answer_guesses = Table<int>(std::move(answer_guesses));
+  allocate_colors_cache(dictionary.get());
+  return dictionary;
+}
+
+// Reads the word lists from files instead, exiting if they're bad.
+void load_tables(const std::string& guesses_path, const std::string& answers_path) {
   printf("Initializing tables.\n");
-  GUESSES = load_file("wordle_allowed_words.txt");
-  ANSWERS = load_file("wordle_answers.txt");
-  for (const std::string& answer : ANSWERS) {
-    ANSWER_LETTER_COUNTS.push_back(get_letter_counts(answer));
+  std::string error;
+  std::shared_ptr<Dictionary> dictionary = read_dictionary(guesses_path, answers_path, &error);
+  if (dictionary == nullptr) {
+    fprintf(stderr, "%s\n", error.c_str());
+    exit(1);
   }
-  COLORS_CACHE.resize(ANSWERS.size() * GUESSES.size(), -1);
+  bind_dictionary(std::move(dictionary));
   printf("Done.\n");
 }
 
-int lookup_guess(const std::string& guess_str) {
+struct DictionaryUpdate {
+  std::vector<std::string> add_guesses;
+  std::vector<std::string> remove_guesses;
+  std::vector<std::string> add_answers;
+  std::vector<std::string> remove_answers;
+};
+
+// Positions in the updated word list of the words an update kept, given
+// their old ones in the order they're kept in, followed by num_added
+// new words at the end, like patch_word_list() leaves the file.
+std::vector<int> renumber_words(const std::vector<int>& kept, int num_added) {
+  std::vector<int> sorted = kept;
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<int> words;
+  for (int word : kept) {
+    words.push_back(std::lower_bound(sorted.begin(), sorted.end(), word) - sorted.begin());
+  }
+  for (int i = 0; i < num_added; i++) {
+    words.push_back(kept.size() + i);
+  }
+  return words;
+}
+
+// Drops the worst-case searches' bounds, which are by answer index.
+void clear_minimax_memos();
+// Moves an open tile store's colors to the new indices, since its
+// tiles are by index too. The maps take old indices to new ones.
+void patch_tile_store(const std::vector<int>& guess_map, const std::vector<int>& answer_map);
+
+// Applies update to this thread's tables by binding a new dictionary.
+// Other solvers sharing the old one don't see the change. Surviving
+// words keep their relative order and added ones go at the end,
+// matching what patch_word_list() does to the files. Only the added
+// words get new letter counts and masks, and colors already in the
+// cache or tile store carry over, so only the new rows and columns are
+// ever computed. Indices held from before the update are invalid
+// afterwards. Returns false without changing anything if the update
+// doesn't make sense.
+bool update_dictionary(const DictionaryUpdate& update) {
+  std::unordered_set<std::string> remove_guesses(update.remove_guesses.begin(),
+						 update.remove_guesses.end());
+  std::unordered_set<std::string> remove_answers(update.remove_answers.begin(),
+						 update.remove_answers.end());
+
+  std::vector<Word> guesses;
+  std::vector<int> guess_letter_masks;
+  std::vector<int> guess_map(GUESSES.size(), -1);  // Old index -> new.
+  std::unordered_map<std::string, int> guess_index;
   for (int i = 0; i < GUESSES.size(); i++) {
-    if (GUESSES[i] == guess_str) {
-      return i;
+    if (remove_guesses.count(GUESSES[i].c_str()) == 0) {
+      guess_map[i] = guesses.size();
+      guess_index[GUESSES[i].c_str()] = guesses.size();
+      guesses.push_back(GUESSES[i]);
+      guess_letter_masks.push_back(GUESS_LETTER_MASKS[i]);
     }
   }
-  assert(false);
-  return -1;
+  if (guess_index.size() + remove_guesses.size() != GUESSES.size()) {
+    fprintf(stderr, "Removing a guess that isn't there\n");
+    return false;
+  }
+  for (const std::string& word : update.add_guesses) {
+    if (!valid_word(word) || !guess_index.insert({word, guesses.size()}).second) {
+      fprintf(stderr, "Can't add guess '%s'\n", word.c_str());
+      return false;
+    }
+    Word guess;
+    word.copy(guess.letters, WORD_LENGTH);
+    guess.letters[WORD_LENGTH] = '\0';
+    guesses.push_back(guess);
+    guess_letter_masks.push_back(get_letter_mask(guess.c_str()));
+  }
+
+  std::vector<Word> answers;
+  std::vector<LetterCounts> answer_letter_counts;
+  std::vector<int> answer_guesses;
+  std::vector<int> answer_map(ANSWERS.size(), -1);
+  std::unordered_set<std::string> answer_words;
+  for (int i = 0; i < ANSWERS.size(); i++) {
+    if (remove_answers.count(ANSWERS[i].c_str()) == 0) {
+      if (guess_map[ANSWER_GUESSES[i]] < 0) {
+	fprintf(stderr, "Answer '%s' would no longer be a guess\n", ANSWERS[i].c_str());
+	return false;
+      }
+      answer_map[i] = answers.size();
+      answer_words.insert(ANSWERS[i].c_str());
+      answers.push_back(ANSWERS[i]);
+      answer_letter_counts.push_back(ANSWER_LETTER_COUNTS[i]);
+      answer_guesses.push_back(guess_map[ANSWER_GUESSES[i]]);
+    }
+  }
+  if (answer_words.size() + remove_answers.size() != ANSWERS.size()) {
+    fprintf(stderr, "Removing an answer that isn't there\n");
+    return false;
+  }
+  for (const std::string& word : update.add_answers) {
+    auto iter = guess_index.find(word);
+    if (iter == guess_index.end() || !answer_words.insert(word).second) {
+      fprintf(stderr, "Can't add answer '%s'\n", word.c_str());
+      return false;
+    }
+    answers.push_back(guesses[iter->second]);
+    answer_letter_counts.push_back(get_letter_counts(word.c_str()));
+    answer_guesses.push_back(iter->second);
+  }
+
+  std::shared_ptr<Dictionary> dictionary(new Dictionary);
+  if (COLORS_CACHE == nullptr) {
+    // Nothing cached to keep. A tile store is patched below.
+  } else if (remove_guesses.empty() && remove_answers.empty() && update.add_answers.empty() &&
+	     DICTIONARY.use_count() == 1) {
+    // Only new rows, at the end, and no other solver is using the old
+    // dictionary, so its cache can be taken over.
+    dictionary->colors_cache = std::move(DICTIONARY->colors_cache);
+    dictionary->colors_cache.resize(guesses.size() * answers.size(), -1);
+  } else {
+    std::vector<int>& colors = dictionary->colors_cache;
+    colors.assign(guesses.size() * answers.size(), -1);
+    for (int guess = 0; guess < GUESSES.size(); guess++) {
+      if (guess_map[guess] < 0) {
+	continue;
+      }
+      const int* old_row = &COLORS_CACHE[guess * ANSWERS.size()];
+      int* new_row = &colors[guess_map[guess] * answers.size()];
+      for (int answer = 0; answer < ANSWERS.size(); answer++) {
+	if (answer_map[answer] >= 0) {
+	  new_row[answer_map[answer]] = __atomic_load_n(&old_row[answer], __ATOMIC_RELAXED);
+	}
+      }
+    }
+  }
+
+  dictionary->guesses = Table<Word>(std::move(guesses));
+  dictionary->answers = Table<Word>(std::move(answers));
+  dictionary->answer_letter_counts = Table<LetterCounts>(std::move(answer_letter_counts));
+  dictionary->guess_letter_masks = Table<int>(std::move(guess_letter_masks));
+  dictionary->answer_guesses = Table<int>(std::move(answer_guesses));
+  if (!DICTIONARY->guess_words.empty()) {
+    // Keep the layout: rows stay where they were, so the word list
+    // positions are what need renumbering.
+    std::vector<int> kept_guesses;
+    for (int guess = 0; guess < GUESSES.size(); guess++) {
+      if (guess_map[guess] >= 0) {
+	kept_guesses.push_back(DICTIONARY->guess_words[guess]);
+      }
+    }
+    std::vector<int> kept_answers;
+    for (int answer = 0; answer < ANSWERS.size(); answer++) {
+      if (answer_map[answer] >= 0) {
+	kept_answers.push_back(DICTIONARY->answer_words[answer]);
+      }
+    }
+    dictionary->guess_words = renumber_words(kept_guesses, update.add_guesses.size());
+    dictionary->answer_words = renumber_words(kept_answers, update.add_answers.size());
+  }
+  index_words(dictionary.get());
+  if (!NUMA_NODES.empty()) {
+    replicate_colors_cache(dictionary.get(), NUMA_NODES);
+  }
+  bind_dictionary(std::move(dictionary));
+  // A pool is only valid for the answers it was reduced against.
+  GUESS_POOL.clear();
+  clear_minimax_memos();
+  patch_tile_store(guess_map, answer_map);
+  return true;
+}
+
+// Applies the same change to a word list file. Additions alone are
+// appended; removals rewrite the file.
+void patch_word_list(const std::string& path,
+		     const std::vector<std::string>& added,
+		     const std::vector<std::string>& removed) {
+  if (removed.empty()) {
+    FILE* f = fopen(path.c_str(), "a");
+    if (f == nullptr) {
+      perror(path.c_str());
+      exit(1);
+    }
+    for (const std::string& word : added) {
+      fprintf(f, "%s\n", word.c_str());
+    }
+    fclose(f);
+    return;
+  }
+  std::unordered_set<std::string> removed_set(removed.begin(), removed.end());
+  const std::string tmp_path = path + ".tmp";
+  FILE* f = fopen(tmp_path.c_str(), "w");
+  if (f == nullptr) {
+    perror(tmp_path.c_str());
+    exit(1);
+  }
+  std::vector<Word> words;
+  std::string error;
+  if (!load_file(path, &words, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    exit(1);
+  }
+  for (const Word& word : words) {
+    if (removed_set.count(word.c_str()) == 0) {
+      fprintf(f, "%s\n", word.c_str());
+    }
+  }
+  for (const std::string& word : added) {
+    fprintf(f, "%s\n", word.c_str());
+  }
+  fclose(f);
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    perror(path.c_str());
+    exit(1);
+  }
+}
+
+// Index of the word in the guess list, or -1 if it isn't one.
+int find_guess(const std::string& word) {
+  return find_word(GUESSES, DICTIONARY->guesses_by_word, word);
+}
+
+int find_answer(const std::string& word) {
+  return find_word(ANSWERS, DICTIONARY->answers_by_word, word);
+}
+
+int lookup_guess(const std::string& guess_str) {
+  const int guess = find_guess(guess_str);
+  assert(guess >= 0);
+  return guess;
 }
 
 int lookup_answer(const std::string& answer_str) {
+  const int answer = find_answer(answer_str);
+  assert(answer >= 0);
+  return answer;
+}
+
+// Every answer, by index.
+std::vector<int> all_answer_indices() {
+  std::vector<int> all_answers;
   for (int i = 0; i < ANSWERS.size(); i++) {
-    if (ANSWERS[i] == answer_str) {
-      return i;
-    }
+    all_answers.push_back(i);
   }
-  assert(false);
-  return -1;
+  return all_answers;
+}
+
+// The guesses searches start from: GUESS_POOL, or else all of them.
+std::vector<int> search_guesses() {
+  if (!GUESS_POOL.empty()) {
+    return GUESS_POOL;
+  }
+  std::vector<int> all_guesses;
+  for (int i = 0; i < GUESSES.size(); i++) {
+    all_guesses.push_back(i);
+  }
+  return all_guesses;
 }
 
 int get_colors_index(const std::string& color_string) {
@@ -120,233 +832,3584 @@ Outcome make_outcome(const std::string& guess, const std::string& colors) {
   return {lookup_guess(guess), get_colors_index(colors)};
 }
 
-int get_colors(int guess, int answer) {
-  const int cache_index = guess * ANSWERS.size() + answer;
-  if (COLORS_CACHE[cache_index] >= 0) {
-    CACHE_HITS++;
-    return COLORS_CACHE[cache_index];
+// Parses "guess:colors", e.g. "reast:---+-". Returns false if text isn't
+// an allowed guess and five colors.
+bool parse_outcome(const std::string& text, Outcome* outcome) {
+  const size_t colon = text.find(':');
+  if (colon == std::string::npos) {
+    return false;
   }
-  CACHE_MISSES++;
-  const std::string guess_str = GUESSES[guess];
-  const std::string answer_str = ANSWERS[answer];
+  const int guess = find_guess(text.substr(0, colon));
+  const std::string colors = text.substr(colon + 1);
+  if (guess < 0 || colors.size() != WORD_LENGTH || strspn(colors.c_str(), "-+!") != WORD_LENGTH) {
+    return false;
+  }
+  *outcome = {guess, get_colors_index(colors)};
+  return true;
+}
+
+// Computes the colors directly, without the cache.
+int compute_colors(int guess, int answer) {
+  const Word& guess_str = GUESSES[guess];
+  const Word& answer_str = ANSWERS[answer];
   std::string colors(WORD_LENGTH, ' ');
   LetterCounts answer_letter_counts = ANSWER_LETTER_COUNTS[answer];
-  LetterCounts guess_letter_counts;
+  LetterCounts guess_letter_counts = {0};
   for (int i = 0; i < WORD_LENGTH; i++) {
+    const int letter = guess_str[i] - 'a';
     if (guess_str[i] == answer_str[i]) {
       colors[i] = '!';
-      guess_letter_counts[guess_str[i]]++;
-    } else if (guess_letter_counts[guess_str[i]] < answer_letter_counts[guess_str[i]]) {
+      guess_letter_counts[letter]++;
+    } else if (guess_letter_counts[letter] < answer_letter_counts[letter]) {
       colors[i] = '+';
-      guess_letter_counts[guess_str[i]]++;
+      guess_letter_counts[letter]++;
     } else {
       colors[i] = '-';
     }
   }
-  int colors_index = get_colors_index(colors);
-  COLORS_CACHE[cache_index] = colors_index;
-  return colors_index;
+  return get_colors_index(colors);
 }
 
-bool possible_answer(int word, const std::vector<Outcome>& outcomes) {
-  for (const Outcome& outcome : outcomes) {
-    if (get_colors(outcome.first, word) != outcome.second) {
-      return false;
-    }
+int get_colors(int guess, int answer) {
+  // In tiled mode, mapping a tile for one entry costs more than
+  // computing it.
+  if (COLORS_CACHE == nullptr) {
+    return compute_colors(guess, answer);
   }
-  return true;
+  // Relaxed is enough: an entry is either unknown or its final value.
+  int* entry = &COLORS_CACHE[guess * ANSWERS.size() + answer];
+  const int cached = __atomic_load_n(entry, __ATOMIC_RELAXED);
+  if (cached >= 0) {
+    CACHE_HITS++;
+    return cached;
+  }
+  CACHE_MISSES++;
+  int colors_index = compute_colors(guess, answer);
+  __atomic_store_n(entry, colors_index, __ATOMIC_RELAXED);
+  return colors_index;
 }
 
-std::vector<int> filter_answers(const std::vector<int>& answers,
-				const std::vector<Outcome>& outcomes) {
-  std::vector<int> filtered;
-  for (int answer : answers) {
-    if (possible_answer(answer, outcomes)) {
-      filtered.push_back(answer);
+// 16 lanes of one letter position, one answer per lane.
+typedef int8_t Lanes __attribute__((vector_size(16)));
+constexpr int NUM_LANES = sizeof(Lanes);
+
+// Matrix-free version of colors_row(). Answers are gathered 16 at a
+// time into one vector per letter position, then all 16 are colored
+// at once with the same left-to-right rules as compute_colors().
+// Comparisons give -1 in lanes where they hold and 0 elsewhere.
+void compute_colors_row(int guess, const int* answers, int num_answers, int* colors) {
+  const Word& guess_str = GUESSES[guess];
+  for (int start = 0; start < num_answers; start += NUM_LANES) {
+    const int n = std::min(NUM_LANES, num_answers - start);
+    Lanes answer_letters[WORD_LENGTH] = {};
+    for (int k = 0; k < n; k++) {
+      const Word& answer_str = ANSWERS[answers[start + k]];
+      for (int p = 0; p < WORD_LENGTH; p++) {
+	answer_letters[p][k] = answer_str[p];
+      }
+    }
+    Lanes colored[WORD_LENGTH];
+    Lanes position_colors[WORD_LENGTH];
+    for (int i = 0; i < WORD_LENGTH; i++) {
+      const Lanes letter = Lanes{} + guess_str[i];
+      Lanes answer_count = {};
+      for (int p = 0; p < WORD_LENGTH; p++) {
+	answer_count -= answer_letters[p] == letter;
+      }
+      Lanes guess_count = {};
+      for (int j = 0; j < i; j++) {
+	if (guess_str[j] == guess_str[i]) {
+	  guess_count -= colored[j];
+	}
+      }
+      const Lanes green = answer_letters[i] == letter;
+      const Lanes yellow = ~green & (guess_count < answer_count);
+      colored[i] = green | yellow;
+      position_colors[i] = (green & 2) | (yellow & 1);
+    }
+    // The index needs 10 bits, so the first position goes on separately.
+    const Lanes low = (position_colors[1] << 6) | (position_colors[2] << 4) |
+      (position_colors[3] << 2) | position_colors[4];
+    for (int k = 0; k < n; k++) {
+      colors[start + k] = (position_colors[0][k] << 8) | static_cast<uint8_t>(low[k]);
     }
   }
-  return filtered;
 }
 
+std::string layout_key();
 
-std::pair<int, double> best_guess(const std::vector<int>& guesses,
-				  const std::vector<int>& answers,
-				  int depth, int max_depth);
+// The guess x answer colors for dictionaries too big for COLORS_CACHE,
+// kept in a file as tiles of TILE_GUESSES x TILE_ANSWERS entries. A
+// tile is computed the first time it's needed and stays in the file for
+// later runs with the same dictionary. Only the TILE_CACHE_MB most
+// recently used tiles are mapped, so memory use doesn't grow with the
+// dictionary.
+//
+// File layout: a TileHeader, one byte per tile that is set once the
+// tile has been computed, then the tiles themselves, guess block-major,
+// each starting on a page. Within a tile each guess's colors against
+// the block's answers are contiguous.
+constexpr int TILE_GUESSES = 256;
+constexpr int TILE_ANSWERS = 4096;
+constexpr size_t TILE_BYTES = TILE_GUESSES * TILE_ANSWERS * sizeof(uint16_t);
 
-double score_guess(int guess,
-		   const std::vector<int>& guesses,
-		   const std::vector<int>& answers) {
-  std::unordered_map<int, int> colors_counts;
-  for (int answer : answers) {
-    ++colors_counts[get_colors(guess, answer)];
-  }
-  double expected_score = 0;
-  double num_answers = static_cast<double>(answers.size());
-  for (const auto& colors_count : colors_counts) {
-    int remaining = colors_count.second;
-    double prob = remaining / num_answers;
-    assert(prob >= 0.0);
-    expected_score += (prob * remaining);
-  }
-  return expected_score;
-}
+class TileStore {
+public:
+  TileStore(const std::string& path, size_t max_mapped_tiles)
+    : max_mapped_tiles_(std::max<size_t>(max_mapped_tiles, 1)) {
+    guess_blocks_ = (GUESSES.size() + TILE_GUESSES - 1) / TILE_GUESSES;
+    answer_blocks_ = (ANSWERS.size() + TILE_ANSWERS - 1) / TILE_ANSWERS;
+    const size_t num_tiles = guess_blocks_ * answer_blocks_;
+    const size_t page = sysconf(_SC_PAGESIZE);
+    header_bytes_ = (sizeof(TileHeader) + num_tiles + page - 1) / page * page;
 
-double score_guess_steps(int guess,
-			 const std::vector<int>& guesses,
-			 const std::vector<int>& answers,
-			 int depth,
-			 int max_depth) {
-  std::unordered_map<int, int> colors_counts;
-  for (int answer : answers) {
-    ++colors_counts[get_colors(guess, answer)];
-  }
-  double expected_score = 0;
-  double num_answers = static_cast<double>(answers.size());
-  for (const auto& colors_count : colors_counts) {
-    int remaining = colors_count.second;
-    double prob = remaining / num_answers;
-    assert(prob >= 0.0);
-    double score;
-    if (colors_count.first == 682) {  // !!!!!
-      score = 0.0;
-    } else if (depth < max_depth) {
-      const Outcome& outcome = {guess, colors_count.first};
-      const std::vector<int> answers_left = filter_answers(answers, {outcome});
-      auto result = best_guess(guesses, answers_left, depth + 1, max_depth);
-      score = result.second + 1.0;
-    } else {
-      score = 5 - depth;  // Assuming all puzzles can be solved within 5.
+    TileHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    snprintf(header.key, sizeof(header.key), "%s tile=%dx%d", layout_key().c_str(),
+	     TILE_GUESSES, TILE_ANSWERS);
+
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      perror(path.c_str());
+      exit(1);
     }
-    expected_score += (prob * score);
+    TileHeader existing = {};
+    if (pread(fd_, &existing, sizeof(existing), 0) != sizeof(existing) ||
+	memcmp(&existing, &header, sizeof(header)) != 0) {
+      // New, or written for another dictionary: start over. The file is
+      // sparse until tiles are filled in.
+      if (ftruncate(fd_, 0) != 0 ||
+	  ftruncate(fd_, header_bytes_ + num_tiles * TILE_BYTES) != 0 ||
+	  pwrite(fd_, &header, sizeof(header), 0) != sizeof(header)) {
+	perror(path.c_str());
+	exit(1);
+      }
+    }
+    void* header_map = mmap(nullptr, header_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (header_map == MAP_FAILED) {
+      perror(path.c_str());
+      exit(1);
+    }
+    computed_ = static_cast<unsigned char*>(header_map) + sizeof(TileHeader);
   }
-  return expected_score;
-}
 
-// Returns guess index, score.
-// Score is expected number of steps until solved.
-std::pair<int, double> best_guess(const std::vector<int>& guesses,
-				  const std::vector<int>& answers,
-				  int depth, int max_depth) {
-  assert(!answers.empty());
-  if (answers.size() == 1) {
-    return {lookup_guess(ANSWERS[answers[0]]), 0.0};
-  }
-  if (depth == 0) {
-    printf("Computing shallow scores.\n");
-  }
-  std::vector<std::pair<int, double>> shallow_scores;
-  std::vector<int> worthwhile_guesses;
-  double threshold = 0.8 * answers.size();
-  for (int guess : guesses) {
-    double score = score_guess(guess, guesses, answers);
-    if (shallow_scores.empty() || (score < threshold)) {
-      shallow_scores.push_back({guess, score});
-      worthwhile_guesses.push_back(guess);
+  ~TileStore() {
+    for (const auto& entry : mapped_) {
+      munmap(entry.second.first, TILE_BYTES);
     }
-  }
-  if (depth == 0) {
-    printf("Done computing shallow scores. %d candidates.\n", shallow_scores.size());
+    munmap(computed_ - sizeof(TileHeader), header_bytes_);
+    close(fd_);
   }
 
-  std::sort(shallow_scores.begin(), shallow_scores.end(), [](auto &left, auto &right) {
-    return left.second < right.second;
+  // Same as colors_row(). Answers are usually in index order, so
+  // consecutive ones fall in the same tile and each tile is looked up
+  // once per run of them.
+  void row(int guess, const int* answers, int num_answers, int* colors) {
+    const int guess_block = guess / TILE_GUESSES;
+    const int offset = guess % TILE_GUESSES * TILE_ANSWERS;
+    int answer_block = -1;
+    const uint16_t* tile_row = nullptr;
+    for (int i = 0; i < num_answers; i++) {
+      if (answers[i] / TILE_ANSWERS != answer_block) {
+	answer_block = answers[i] / TILE_ANSWERS;
+	tile_row = tile(guess_block, answer_block) + offset;
+      }
+      colors[i] = tile_row[answers[i] % TILE_ANSWERS];
+    }
+  }
+
+  long long tiles_computed() const { return tiles_computed_; }
+  long long tiles_mapped() const { return tiles_mapped_; }
+
+  // Fills this store, opened for the current dictionary, from old, which
+  // was opened for the one before an update. The sources take each new
+  // guess and answer to its old index, or -1 if it was added. A tile is
+  // filled if every old tile it draws from was computed, and then only
+  // its added rows and columns are computed; the rest are left to be
+  // computed whole when they're first needed.
+  void patch(TileStore& old, const std::vector<int>& guess_sources,
+	     const std::vector<int>& answer_sources) {
+    std::vector<int> answers;
+    std::vector<int> colors(TILE_ANSWERS);
+    for (int guess_block = 0; guess_block < guess_blocks_; guess_block++) {
+      const int first_guess = guess_block * TILE_GUESSES;
+      const int last_guess = std::min<int>(first_guess + TILE_GUESSES, GUESSES.size());
+      for (int answer_block = 0; answer_block < answer_blocks_; answer_block++) {
+	const int first_answer = answer_block * TILE_ANSWERS;
+	const int last_answer = std::min<int>(first_answer + TILE_ANSWERS, ANSWERS.size());
+	if (!sources_computed(old, guess_sources, first_guess, last_guess,
+			      answer_sources, first_answer, last_answer)) {
+	  continue;
+	}
+	const int id = guess_block * answer_blocks_ + answer_block;
+	void* map = mmap(nullptr, TILE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+			 header_bytes_ + id * TILE_BYTES);
+	if (map == MAP_FAILED) {
+	  perror("mmap");
+	  exit(1);
+	}
+	uint16_t* data = static_cast<uint16_t*>(map);
+	for (int guess = first_guess; guess < last_guess; guess++) {
+	  uint16_t* tile_row = data + (guess - first_guess) * TILE_ANSWERS - first_answer;
+	  const int old_guess = guess_sources[guess];
+	  int old_block = -1;
+	  const uint16_t* old_row = nullptr;
+	  answers.clear();
+	  for (int answer = first_answer; answer < last_answer; answer++) {
+	    const int old_answer = answer_sources[answer];
+	    if (old_guess < 0 || old_answer < 0) {
+	      answers.push_back(answer);
+	      continue;
+	    }
+	    if (old_answer / TILE_ANSWERS != old_block) {
+	      old_block = old_answer / TILE_ANSWERS;
+	      old_row = old.tile(old_guess / TILE_GUESSES, old_block) +
+		old_guess % TILE_GUESSES * TILE_ANSWERS;
+	    }
+	    tile_row[answer] = old_row[old_answer % TILE_ANSWERS];
+	  }
+	  compute_colors_row(guess, answers.data(), answers.size(), colors.data());
+	  for (int i = 0; i < answers.size(); i++) {
+	    tile_row[answers[i]] = colors[i];
+	  }
+	}
+	munmap(map, TILE_BYTES);
+	computed_[id] = 1;
+      }
+    }
+  }
+
+private:
+  static constexpr char MAGIC[8] = {'W', 'L', 'T', 'I', 'L', 'E', 'S', '1'};
+
+  struct TileHeader {
+    char magic[8];
+    char key[248];
+  };
+
+  // Whether every tile of old that the new guesses and answers in
+  // [first, last) draw from has been computed.
+  static bool sources_computed(const TileStore& old, const std::vector<int>& guess_sources,
+			       int first_guess, int last_guess,
+			       const std::vector<int>& answer_sources, int first_answer,
+			       int last_answer) {
+    std::unordered_set<int> guess_blocks;
+    for (int guess = first_guess; guess < last_guess; guess++) {
+      if (guess_sources[guess] >= 0) {
+	guess_blocks.insert(guess_sources[guess] / TILE_GUESSES);
+      }
+    }
+    std::unordered_set<int> answer_blocks;
+    for (int answer = first_answer; answer < last_answer; answer++) {
+      if (answer_sources[answer] >= 0) {
+	answer_blocks.insert(answer_sources[answer] / TILE_ANSWERS);
+      }
+    }
+    for (int guess_block : guess_blocks) {
+      for (int answer_block : answer_blocks) {
+	if (!old.computed_[guess_block * old.answer_blocks_ + answer_block]) {
+	  return false;
+	}
+      }
+    }
+    return true;
+  }
+
+  const uint16_t* tile(int guess_block, int answer_block) {
+    const int id = guess_block * answer_blocks_ + answer_block;
+    auto iter = mapped_.find(id);
+    if (iter != mapped_.end()) {
+      lru_.splice(lru_.begin(), lru_, iter->second.second);
+      return iter->second.first;
+    }
+    if (mapped_.size() >= max_mapped_tiles_) {
+      const int evicted = lru_.back();
+      munmap(mapped_[evicted].first, TILE_BYTES);
+      mapped_.erase(evicted);
+      lru_.pop_back();
+    }
+    void* map = mmap(nullptr, TILE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+		     header_bytes_ + id * TILE_BYTES);
+    if (map == MAP_FAILED) {
+      perror("mmap");
+      exit(1);
+    }
+    tiles_mapped_++;
+    uint16_t* data = static_cast<uint16_t*>(map);
+    if (!computed_[id]) {
+      fill(guess_block, answer_block, data);
+      computed_[id] = 1;
+      tiles_computed_++;
+    }
+    lru_.push_front(id);
+    mapped_[id] = {data, lru_.begin()};
+    return data;
+  }
+
+  void fill(int guess_block, int answer_block, uint16_t* data) {
+    const int first_answer = answer_block * TILE_ANSWERS;
+    const int num_answers = std::min<int>(TILE_ANSWERS, ANSWERS.size() - first_answer);
+    std::vector<int> answers(num_answers);
+    for (int i = 0; i < num_answers; i++) {
+      answers[i] = first_answer + i;
+    }
+    std::vector<int> colors(num_answers);
+    const int first_guess = guess_block * TILE_GUESSES;
+    const int last_guess = std::min<int>(first_guess + TILE_GUESSES, GUESSES.size());
+    for (int guess = first_guess; guess < last_guess; guess++) {
+      compute_colors_row(guess, answers.data(), num_answers, colors.data());
+      std::copy(colors.begin(), colors.end(), data + (guess - first_guess) * TILE_ANSWERS);
+    }
+  }
+
+  int fd_ = -1;
+  int guess_blocks_;
+  int answer_blocks_;
+  size_t header_bytes_;
+  unsigned char* computed_;
+  size_t max_mapped_tiles_;
+  // Tile ids, most recently used first.
+  std::list<int> lru_;
+  std::unordered_map<int, std::pair<uint16_t*, std::list<int>::iterator>> mapped_;
+  long long tiles_computed_ = 0;
+  long long tiles_mapped_ = 0;
+};
+
+// Opened by open_tile_store() once the dictionary is loaded.
+thread_local std::unique_ptr<TileStore> TILE_STORE;
+
+void open_tile_store() {
+  TILE_STORE.reset();
+  TILE_STORE.reset(new TileStore(TILE_STORE_PATH, (size_t(TILE_CACHE_MB) << 20) / TILE_BYTES));
+}
+
+// Opens the tile store again for the thread's new dictionary, if one
+// is open. The file's key no longer matches, so it starts over.
+void reopen_tile_store() {
+  if (TILE_STORE) {
+    open_tile_store();
+  }
+}
+
+void patch_tile_store(const std::vector<int>& guess_map, const std::vector<int>& answer_map) {
+  if (!TILE_STORE) {
+    return;
+  }
+  std::vector<int> guess_sources(GUESSES.size(), -1);
+  for (int guess = 0; guess < guess_map.size(); guess++) {
+    if (guess_map[guess] >= 0) {
+      guess_sources[guess_map[guess]] = guess;
+    }
+  }
+  std::vector<int> answer_sources(ANSWERS.size(), -1);
+  for (int answer = 0; answer < answer_map.size(); answer++) {
+    if (answer_map[answer] >= 0) {
+      answer_sources[answer_map[answer]] = answer;
+    }
+  }
+  // Written beside the old file and renamed over it, so a run that dies
+  // partway leaves the old store as it was.
+  const std::string path = TILE_STORE_PATH + ".new";
+  unlink(path.c_str());
+  std::unique_ptr<TileStore> old = std::move(TILE_STORE);
+  TILE_STORE.reset(new TileStore(path, (size_t(TILE_CACHE_MB) << 20) / TILE_BYTES));
+  TILE_STORE->patch(*old, guess_sources, answer_sources);
+  old.reset();
+  if (rename(path.c_str(), TILE_STORE_PATH.c_str()) != 0) {
+    perror(TILE_STORE_PATH.c_str());
+    exit(1);
+  }
+}
+
+// Nodes with at most this many answers gather a SubMatrix for the
+// nodes below them.
+constexpr int SUBMATRIX_MAX_ANSWERS = 150;
+
+struct SubMatrix;
+// The SubMatrix colors_row() reads from, if any.
+thread_local const SubMatrix* SUBMATRIX = nullptr;
+
+// Fills colors[i] with get_colors(guess, answers[i]). All scoring and
+// partitioning goes through here, so in matrix-free and tiled modes it
+// never touches COLORS_CACHE.
+void colors_row(int guess, const int* answers, int num_answers, int* colors);
+
+// The colors of a node's guess pool against its answers, gathered into
+// one dense block so the nodes below it, whose answers are subsets of
+// these, scan a short contiguous row per guess instead of gathering
+// from scattered columns of the full matrix. colors_row() reads from it
+// for as long as it exists. Guesses outside the pool still go to the
+// full matrix.
+struct SubMatrix {
+  SubMatrix(const std::vector<int>& guesses, const std::vector<int>& answers)
+    : rows(GUESSES.size(), -1), columns(ANSWERS.size(), -1), num_columns(answers.size()),
+      colors(guesses.size() * answers.size()) {
+    assert(SUBMATRIX == nullptr);
+    std::vector<int> row(answers.size());
+    for (int r = 0; r < guesses.size(); r++) {
+      colors_row(guesses[r], answers.data(), answers.size(), row.data());
+      std::copy(row.begin(), row.end(), colors.begin() + r * num_columns);
+      rows[guesses[r]] = r;
+    }
+    for (int c = 0; c < answers.size(); c++) {
+      columns[answers[c]] = c;
+    }
+    SUBMATRIX = this;
+  }
+  ~SubMatrix() { SUBMATRIX = nullptr; }
+
+  std::vector<int> rows;  // Guess -> row, or -1.
+  std::vector<int> columns;  // Answer -> column.
+  int num_columns;
+  std::vector<uint16_t> colors;
+};
+
+void colors_row(int guess, const int* answers, int num_answers, int* colors) {
+  if (SUBMATRIX != nullptr && SUBMATRIX->rows[guess] >= 0) {
+    const uint16_t* row = &SUBMATRIX->colors[SUBMATRIX->rows[guess] * SUBMATRIX->num_columns];
+    for (int i = 0; i < num_answers; i++) {
+      colors[i] = row[SUBMATRIX->columns[answers[i]]];
+    }
+    return;
+  }
+  if (MATRIX_FREE) {
+    compute_colors_row(guess, answers, num_answers, colors);
+    return;
+  }
+  if (TILE_STORE) {
+    TILE_STORE->row(guess, answers, num_answers, colors);
+    return;
+  }
+  for (int i = 0; i < num_answers; i++) {
+    colors[i] = get_colors(guess, answers[i]);
+  }
+}
+
+// Lays this thread's tables out so searches touch less memory, and binds
+// the result. Answers are grouped by the colors opener gets against
+// them, biggest group first, so the subsets left after it are ranges of
+// columns and the rows a search reads are only touched in one place.
+// Guesses are ordered by how many answers sit in groups where they're
+// worth scoring, under best_guess()'s threshold, so the guesses a search
+// keeps expanding are a dense prefix of the rows. Each keeps its word
+// list position in guess_words and answer_words. Results don't depend on
+// the layout, except that ties may go another way.
+void reorder_dictionary(const std::string& opener) {
+  const int opener_guess = lookup_guess(opener);
+  const int n = ANSWERS.size();
+  const std::vector<int> all_answers = all_answer_indices();
+  std::vector<int> opener_colors(n);
+  compute_colors_row(opener_guess, all_answers.data(), n, opener_colors.data());
+  std::vector<int> group_sizes(683, 0);
+  for (int colors : opener_colors) {
+    group_sizes[colors]++;
+  }
+  std::vector<int> answer_order = all_answers;
+  std::stable_sort(answer_order.begin(), answer_order.end(), [&](int left, int right) {
+    const int left_colors = opener_colors[left];
+    const int right_colors = opener_colors[right];
+    if (group_sizes[left_colors] != group_sizes[right_colors]) {
+      return group_sizes[left_colors] > group_sizes[right_colors];
+    }
+    return left_colors < right_colors;
+  });
+
+  // Where each group starts in answer_order.
+  std::vector<int> group_starts;
+  for (int i = 0; i < n; i++) {
+    if (i == 0 || opener_colors[answer_order[i]] != opener_colors[answer_order[i - 1]]) {
+      group_starts.push_back(i);
+    }
+  }
+  group_starts.push_back(n);
+
+  std::vector<long long> hotness(GUESSES.size(), 0);
+  std::vector<int> colors(n);
+  std::vector<int> counts(683, 0);
+  for (int guess = 0; guess < GUESSES.size(); guess++) {
+    compute_colors_row(guess, answer_order.data(), n, colors.data());
+    for (int g = 0; g + 1 < group_starts.size(); g++) {
+      const int start = group_starts[g];
+      const int size = group_starts[g + 1] - start;
+      if (size == 1) {
+	continue;
+      }
+      long long sum_squares = 0;
+      for (int i = start; i < start + size; i++) {
+	sum_squares += 2 * counts[colors[i]]++ + 1;
+      }
+      for (int i = start; i < start + size; i++) {
+	counts[colors[i]] = 0;
+      }
+      if (sum_squares < 0.8 * size * size) {
+	hotness[guess] += size;
+      }
+    }
+  }
+  std::vector<int> guess_order;
+  for (int guess = 0; guess < GUESSES.size(); guess++) {
+    guess_order.push_back(guess);
+  }
+  std::stable_sort(guess_order.begin(), guess_order.end(), [&](int left, int right) {
+    return hotness[left] > hotness[right];
+  });
+
+  std::vector<int> guess_rows(GUESSES.size());  // Old index -> new.
+  std::shared_ptr<Dictionary> dictionary(new Dictionary);
+  std::vector<Word> guesses;
+  std::vector<int> guess_letter_masks;
+  for (int guess : guess_order) {
+    guess_rows[guess] = guesses.size();
+    guesses.push_back(GUESSES[guess]);
+    guess_letter_masks.push_back(GUESS_LETTER_MASKS[guess]);
+    dictionary->guess_words.push_back(
+      DICTIONARY->guess_words.empty() ? guess : DICTIONARY->guess_words[guess]);
+  }
+  std::vector<Word> answers;
+  std::vector<LetterCounts> answer_letter_counts;
+  std::vector<int> answer_guesses;
+  for (int answer : answer_order) {
+    answers.push_back(ANSWERS[answer]);
+    answer_letter_counts.push_back(ANSWER_LETTER_COUNTS[answer]);
+    answer_guesses.push_back(guess_rows[ANSWER_GUESSES[answer]]);
+    dictionary->answer_words.push_back(
+      DICTIONARY->answer_words.empty() ? answer : DICTIONARY->answer_words[answer]);
+  }
+  dictionary->guesses = Table<Word>(std::move(guesses));
+  dictionary->answers = Table<Word>(std::move(answers));
+  dictionary->answer_letter_counts = Table<LetterCounts>(std::move(answer_letter_counts));
+  dictionary->guess_letter_masks = Table<int>(std::move(guess_letter_masks));
+  dictionary->answer_guesses = Table<int>(std::move(answer_guesses));
+  index_words(dictionary.get());
+  allocate_colors_cache(dictionary.get());
+  bind_dictionary(std::move(dictionary));
+  clear_minimax_memos();
+  reopen_tile_store();
+}
+
+bool possible_answer(int word, const std::vector<Outcome>& outcomes) {
+  for (const Outcome& outcome : outcomes) {
+    if (get_colors(outcome.first, word) != outcome.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<int> filter_answers(const std::vector<int>& answers,
+				const std::vector<Outcome>& outcomes) {
+  std::vector<int> filtered;
+  for (int answer : answers) {
+    if (possible_answer(answer, outcomes)) {
+      filtered.push_back(answer);
+    }
+  }
+  return filtered;
+}
+
+
+// Returns the letters that don't sit in the same positions in every
+// one of answers. A guess's colors only depend on where its letters
+// are in the answer, so a guess with none of these letters colors all
+// of answers the same and can't tell them apart.
+int informative_letters(const std::vector<int>& answers) {
+  int any[WORD_LENGTH] = {0};
+  int all[WORD_LENGTH];
+  std::fill(all, all + WORD_LENGTH, (1 << 26) - 1);
+  for (int answer : answers) {
+    const Word& answer_str = ANSWERS[answer];
+    for (int i = 0; i < WORD_LENGTH; i++) {
+      const int letter = 1 << (answer_str[i] - 'a');
+      any[i] |= letter;
+      all[i] &= letter;
+    }
+  }
+  int letters = 0;
+  for (int i = 0; i < WORD_LENGTH; i++) {
+    letters |= any[i] & ~all[i];
+  }
+  return letters;
+}
+
+class Checkpoint;
+
+std::pair<int, double> best_guess(const std::vector<int>& guesses,
+				  const std::vector<int>& answers,
+				  int depth, int max_depth,
+				  Checkpoint* checkpoint = nullptr);
+
+double score_guess(int guess,
+		   const std::vector<int>& guesses,
+		   const std::vector<int>& answers) {
+  std::vector<int> colors(answers.size());
+  colors_row(guess, answers.data(), answers.size(), colors.data());
+  std::unordered_map<int, int> colors_counts;
+  for (int c : colors) {
+    ++colors_counts[c];
+  }
+  double expected_score = 0;
+  double num_answers = static_cast<double>(answers.size());
+  for (const auto& colors_count : colors_counts) {
+    int remaining = colors_count.second;
+    double prob = remaining / num_answers;
+    assert(prob >= 0.0);
+    expected_score += (prob * remaining);
+  }
+  return expected_score;
+}
+
+// Shallow scores of a guess pool over an answer subset that keep up as
+// the subset loses answers. Each guess's pattern histogram and its sum
+// of squares are kept, so dropping an answer only counts it out of each
+// histogram, and a score is the sum over the number of answers left:
+// narrowing costs what was dropped rather than what is left, and
+// nothing is rescored. When more is dropped than kept, the histograms
+// are built again from what is kept instead.
+class ShallowScores {
+public:
+  ShallowScores(const std::vector<int>& guesses, const std::vector<int>& answers)
+    : dictionary_(DICTIONARY), guesses_(guesses), rows_(GUESSES.size(), -1),
+      counts_(guesses.size() * 683, 0), sum_squares_(guesses.size(), 0) {
+    for (int i = 0; i < guesses_.size(); i++) {
+      rows_[guesses_[i]] = i;
+    }
+    narrow(answers);
+  }
+
+  const std::vector<int>& guesses() const { return guesses_; }
+  const std::vector<int>& answers() const { return answers_; }
+
+  // Whether narrow() can take answers: still the thread's dictionary,
+  // and answers, sorted, a subset of answers().
+  bool covers(const std::vector<int>& answers) const {
+    return dictionary_.lock() == DICTIONARY && std::includes(answers_.begin(), answers_.end(),
+					     answers.begin(), answers.end());
+  }
+
+  // Leaves just answers, which covers() must allow.
+  void narrow(const std::vector<int>& answers) {
+    assert(answers.size() < 65536 && (answers_.empty() || covers(answers)));
+    std::vector<int> removed;
+    std::set_difference(answers_.begin(), answers_.end(), answers.begin(), answers.end(),
+			std::back_inserter(removed));
+    if (answers_.empty() || removed.size() > answers.size()) {
+      std::fill(counts_.begin(), counts_.end(), 0);
+      std::fill(sum_squares_.begin(), sum_squares_.end(), 0);
+      count(answers, 1);
+    } else {
+      count(removed, -1);
+    }
+    answers_ = answers;
+  }
+
+  // score_guess() of guess, or -1 if it isn't in the pool.
+  double score(int guess) const {
+    const int row = rows_[guess];
+    if (row < 0) {
+      return -1;
+    }
+    return static_cast<double>(sum_squares_[row]) / answers_.size();
+  }
+
+private:
+  // Adds answers to every histogram, or takes them out if sign is -1.
+  void count(const std::vector<int>& answers, int sign) {
+    std::vector<int> colors(answers.size());
+    for (int i = 0; i < guesses_.size(); i++) {
+      colors_row(guesses_[i], answers.data(), answers.size(), colors.data());
+      uint16_t* counts = &counts_[i * 683];
+      long long sum_squares = sum_squares_[i];
+      for (int c : colors) {
+	// (k + 1)^2 - k^2 = 2k + 1.
+	if (sign > 0) {
+	  sum_squares += 2 * counts[c]++ + 1;
+	} else {
+	  sum_squares -= 2 * --counts[c] + 1;
+	}
+      }
+      sum_squares_[i] = sum_squares;
+    }
+  }
+
+  // Not kept alive by this, so updates can still take over its cache.
+  std::weak_ptr<Dictionary> dictionary_;
+  std::vector<int> guesses_;
+  std::vector<int> answers_;
+  std::vector<int> rows_;  // Guess -> index in guesses_, or -1.
+  std::vector<uint16_t> counts_;  // Guess index x colors.
+  std::vector<long long> sum_squares_;
+};
+
+// Set by solve() with --incremental_scores: the root's shallow scores,
+// kept from one solve() to the next so a later turn only counts out the
+// answers its outcome ruled out. best_guess() uses it at the root when
+// the answers match.
+bool INCREMENTAL_SCORES = false;
+thread_local std::unique_ptr<ShallowScores> ROOT_SCORES;
+
+// score_guess() of every guess over each of several answer subsets,
+// e.g. the states of concurrent games, as scores[subset][guess]. Rather
+// than sweeping the matrix once per subset, each guess's row is fetched
+// once, over the union of the subsets, and every subset is scored from
+// it while it's still in cache.
+std::vector<std::vector<double>> score_guesses_batch(
+    const std::vector<int>& guesses, const std::vector<std::vector<int>>& subsets) {
+  std::vector<int> union_answers;
+  for (const std::vector<int>& answers : subsets) {
+    union_answers.insert(union_answers.end(), answers.begin(), answers.end());
+  }
+  std::sort(union_answers.begin(), union_answers.end());
+  union_answers.erase(std::unique(union_answers.begin(), union_answers.end()),
+		      union_answers.end());
+  // Each subset's answers as positions in union_answers.
+  std::vector<std::vector<int>> positions(subsets.size());
+  for (int s = 0; s < subsets.size(); s++) {
+    for (int answer : subsets[s]) {
+      positions[s].push_back(
+	std::lower_bound(union_answers.begin(), union_answers.end(), answer) -
+	union_answers.begin());
+    }
+  }
+
+  std::vector<std::vector<double>> scores(subsets.size(), std::vector<double>(guesses.size()));
+  std::vector<int> colors(union_answers.size());
+  std::array<int, 683> counts = {0};
+  for (int g = 0; g < guesses.size(); g++) {
+    colors_row(guesses[g], union_answers.data(), union_answers.size(), colors.data());
+    for (int s = 0; s < subsets.size(); s++) {
+      long long sum_squares = 0;
+      for (int position : positions[s]) {
+	sum_squares += 2 * counts[colors[position]]++ + 1;
+      }
+      for (int position : positions[s]) {
+	counts[colors[position]] = 0;
+      }
+      scores[s][g] = subsets[s].empty() ? 0.0 :
+	static_cast<double>(sum_squares) / subsets[s].size();
+    }
+  }
+  return scores;
+}
+
+// Sizes past the end of LEAF_VALUES use its logarithmic fit.
+double leaf_value(int num_answers) {
+  if (num_answers < LEAF_VALUES.size()) {
+    return LEAF_VALUES[num_answers];
+  }
+  return LEAF_VALUE_INTERCEPT + LEAF_VALUE_SLOPE * std::log(num_answers);
+}
+
+// Expected number of guesses after this one to solve answers if guess
+// is made next, valuing the buckets it leaves with leaf_value(). This
+// way the estimate sees how the answers split, not just how many there
+// are.
+double estimate_steps(int guess, const std::vector<int>& answers) {
+  std::vector<int> colors(answers.size());
+  colors_row(guess, answers.data(), answers.size(), colors.data());
+  std::array<int, 683> counts = {0};
+  for (int c : colors) {
+    counts[c]++;
+  }
+  double expected_score = 0;
+  for (int c = 0; c < 682; c++) {  // 682 is !!!!!, which takes no more guesses.
+    if (counts[c] > 0) {
+      expected_score += counts[c] * (1 + leaf_value(counts[c]));
+    }
+  }
+  return expected_score / answers.size();
+}
+
+// How many of answers get each colors against guess, as (colors,
+// count) pairs in the order searches go through them, with each
+// answer's colors in colors.
+std::vector<std::pair<int, int>> count_colors(int guess, const std::vector<int>& answers,
+					      std::vector<int>* colors) {
+  colors->resize(answers.size());
+  colors_row(guess, answers.data(), answers.size(), colors->data());
+  std::unordered_map<int, int> colors_counts;
+  for (int c : *colors) {
+    ++colors_counts[c];
+  }
+  return {colors_counts.begin(), colors_counts.end()};
+}
+
+// The answers count_colors() put in the bucket for bucket_colors.
+std::vector<int> bucket_answers(const std::vector<int>& answers, const std::vector<int>& colors,
+				int bucket_colors) {
+  std::vector<int> answers_left;
+  for (int i = 0; i < answers.size(); i++) {
+    if (colors[i] == bucket_colors) {
+      answers_left.push_back(answers[i]);
+    }
+  }
+  return answers_left;
+}
+
+// Expected guesses after the one that leaves a bucket that isn't
+// searched: none for !!!!!, else an estimate at max_depth.
+double unsearched_bucket_score(int bucket_colors, int remaining, int depth) {
+  if (bucket_colors == 682) {  // !!!!!
+    return 0.0;
+  }
+  if (LEAF_ESTIMATOR) {
+    return 1 + leaf_value(remaining);
+  }
+  return 5 - depth;  // Assuming all puzzles can be solved within 5.
+}
+
+// TRACER's frame for a bucket.
+std::string bucket_frame(int bucket_colors, int remaining) {
+  return lookup_colors(bucket_colors) + "[" + std::to_string(remaining) + "]";
+}
+
+std::string subset_key(const std::vector<int>& answers) {
+  return std::string(reinterpret_cast<const char*>(answers.data()),
+		     answers.size() * sizeof(int));
+}
+
+// Set by leaderboard(): the results of the searches of the buckets
+// the root's guesses leave, by subset_key(), so guesses that leave the
+// same bucket share its search. Only valid while every root search has
+// the same guesses and max_depth, since those decide the results too.
+thread_local std::unordered_map<std::string, std::pair<int, double>>* SUBTREE_MEMO = nullptr;
+
+double score_guess_steps(int guess,
+			 const std::vector<int>& guesses,
+			 const std::vector<int>& answers,
+			 int depth,
+			 int max_depth) {
+  if (TRACER) {
+    TRACER->push(GUESSES[guess].c_str());
+  }
+  std::vector<int> colors;
+  double expected_score = 0;
+  double num_answers = static_cast<double>(answers.size());
+  for (const auto& colors_count : count_colors(guess, answers, &colors)) {
+    int remaining = colors_count.second;
+    double prob = remaining / num_answers;
+    assert(prob >= 0.0);
+    double score;
+    if (colors_count.first != 682 && depth < max_depth) {
+      const std::vector<int> answers_left = bucket_answers(answers, colors, colors_count.first);
+      if (TRACER) {
+	TRACER->push(bucket_frame(colors_count.first, remaining));
+      }
+      std::pair<int, double> result;
+      if (depth == 0 && SUBTREE_MEMO) {
+	const std::string key = subset_key(answers_left);
+	auto found = SUBTREE_MEMO->find(key);
+	if (found == SUBTREE_MEMO->end()) {
+	  found = SUBTREE_MEMO->insert(
+	    {key, best_guess(guesses, answers_left, depth + 1, max_depth)}).first;
+	}
+	result = found->second;
+      } else {
+	result = best_guess(guesses, answers_left, depth + 1, max_depth);
+      }
+      if (TRACER) {
+	TRACER->pop();
+      }
+      score = result.second + 1.0;
+    } else {
+      score = unsearched_bucket_score(colors_count.first, remaining, depth);
+    }
+    expected_score += (prob * score);
+  }
+  if (TRACER) {
+    TRACER->pop();
+  }
+  return expected_score;
+}
+
+struct ScoreEstimate {
+  double score;
+  double error;  // Standard error of score.
+};
+
+// Estimates score_guess(guess, answers) from the first sample_size
+// entries of sample, a shuffled copy of answers. score_guess() is
+// 1 + (n - 1) * q, where q is the chance that two different answers
+// land in the same bucket. The fraction of colliding pairs in the
+// sample is an unbiased estimate of q. Its standard error comes from
+// the usual U-statistic variance 4 Var(p_bucket) / m, with a finite
+// population correction and a floor of one sample's worth.
+ScoreEstimate estimate_score(int guess, const std::vector<int>& sample,
+			     int sample_size, int num_answers) {
+  std::vector<int> colors(sample_size);
+  colors_row(guess, sample.data(), sample_size, colors.data());
+  std::array<int, 683> counts = {0};
+  double sum_squares = 0;
+  double sum_cubes = 0;
+  for (int i = 0; i < sample_size; i++) {
+    const double c = counts[colors[i]]++;
+    sum_squares += 2 * c + 1;
+    sum_cubes += 3 * c * c + 3 * c + 1;
+  }
+  const double m = sample_size;
+  const double n = num_answers;
+  const double collisions = (sum_squares - m) / (m * (m - 1));
+  const double p2 = sum_squares / (m * m);
+  const double p3 = sum_cubes / (m * m * m);
+  const double variance = std::max(0.0, p3 - p2 * p2);
+  const double correction = (n - m) / (n - 1);
+  const double error = std::max(std::sqrt(4 * variance / m * correction), 1 / m);
+  return {1 + (n - 1) * collisions, (n - 1) * error};
+}
+
+// Shallow pass by successive halving, for wide roots. Every guess is
+// first scored on a small random sample of answers, and the sample
+// doubles each round for whatever is left. A guess is dropped once its
+// lower confidence bound is above the MAX_CANDIDATES-th best upper
+// bound, and its pool membership is settled once both bounds are on
+// the same side of threshold. The bounds are z standard errors wide,
+// with z chosen so all rounds and guesses together fail with
+// probability about HALVING_FAILURE_PROBABILITY. Only the survivors
+// and unsettled guesses are scored exactly. Fills shallow_scores with
+// the exactly scored contenders under threshold, and
+// worthwhile_guesses with the pool for the children, in guess order
+// like the exact pass.
+void shallow_scores_halving(const std::vector<int>& guesses,
+			    const std::vector<int>& answers,
+			    double threshold,
+			    std::vector<std::pair<int, double>>* shallow_scores,
+			    std::vector<int>* worthwhile_guesses) {
+  const int n = answers.size();
+  std::vector<int> sample = answers;
+  std::shuffle(sample.begin(), sample.end(), std::mt19937(n));
+  int rounds = 1;
+  for (int m = HALVING_INITIAL_SAMPLE; m < n / 2; m *= 2) {
+    rounds++;
+  }
+  const double z = std::sqrt(2 * std::log(2.0 * guesses.size() * rounds /
+					  HALVING_FAILURE_PROBABILITY));
+
+  std::vector<char> contender(guesses.size(), 1);
+  std::vector<char> unsettled(guesses.size(), 1);
+  std::vector<char> worthwhile(guesses.size(), 0);
+  std::vector<double> lower(guesses.size());
+  for (int m = HALVING_INITIAL_SAMPLE; m < n / 2; m *= 2) {
+    std::vector<double> uppers;
+    for (int i = 0; i < guesses.size(); i++) {
+      if (!contender[i] && !unsettled[i]) {
+	continue;
+      }
+      const ScoreEstimate estimate = estimate_score(guesses[i], sample, m, n);
+      lower[i] = estimate.score - z * estimate.error;
+      const double upper = estimate.score + z * estimate.error;
+      if (unsettled[i] && (upper < threshold || lower[i] >= threshold)) {
+	unsettled[i] = 0;
+	worthwhile[i] = upper < threshold;
+      }
+      if (contender[i]) {
+	uppers.push_back(upper);
+      }
+    }
+    if (uppers.size() <= MAX_CANDIDATES) {
+      break;
+    }
+    std::nth_element(uppers.begin(), uppers.begin() + MAX_CANDIDATES - 1, uppers.end());
+    const double cutoff = uppers[MAX_CANDIDATES - 1];
+    int num_contenders = 0;
+    for (int i = 0; i < guesses.size(); i++) {
+      if (contender[i] && lower[i] > cutoff) {
+	contender[i] = 0;
+      }
+      num_contenders += contender[i];
+    }
+    if (VERBOSE) {
+      printf("Sampled %d answers: %d contenders left.\n", m, num_contenders);
+    }
+  }
+
+  std::pair<int, double> best = {-1, 0};
+  for (int i = 0; i < guesses.size(); i++) {
+    if (!contender[i] && !unsettled[i]) {
+      continue;
+    }
+    const double score = score_guess(guesses[i], guesses, answers);
+    worthwhile[i] = score < threshold;
+    if (contender[i] && worthwhile[i]) {
+      shallow_scores->push_back({guesses[i], score});
+    }
+    if (contender[i] && (best.first < 0 || score < best.second)) {
+      best = {guesses[i], score};
+    }
+  }
+  if (shallow_scores->empty()) {
+    // Like the exact pass, always keep something.
+    assert(best.first >= 0);
+    shallow_scores->push_back(best);
+  }
+  for (int i = 0; i < guesses.size(); i++) {
+    if (worthwhile[i]) {
+      worthwhile_guesses->push_back(guesses[i]);
+    }
+  }
+}
+
+// Called with the index into the candidate list and the score as each
+// root candidate finishes, in completion order.
+using CandidateCallback = std::function<void(int, double)>;
+
+struct Worker {
+  pid_t pid;
+  int fd;
+  int slot;  // Passed to enter_numa_node(); a replacement takes over its slot.
+  int task;  // Task being run, -1 if idle.
+};
+
+bool read_full(int fd, void* buf, size_t size) {
+  char* p = static_cast<char*>(buf);
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool send_full(int fd, const void* buf, size_t size) {
+  const char* p = static_cast<const char*>(buf);
+  while (size > 0) {
+    // MSG_NOSIGNAL so a dead worker shows up as an error, not SIGPIPE.
+    ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Forks a worker that runs body with its end of a socket, then exits.
+// The child inherits the tables and the search inputs copy-on-write,
+// so nothing but what body sends and receives ever crosses the
+// socket. It closes the sockets of the workers forked before it,
+// searches without workers of its own, and goes to the NUMA node for
+// slot unless that's -1.
+Worker fork_worker(const std::vector<Worker>& workers, int slot,
+		   const std::function<void(int)>& body) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    perror("socketpair");
+    exit(1);
+  }
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    exit(1);
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    for (const Worker& worker : workers) {
+      close(worker.fd);
+    }
+    NUM_WORKERS = 0;
+    if (slot >= 0) {
+      enter_numa_node(slot);
+    }
+    body(fds[1]);
+    _exit(0);
+  }
+  close(fds[1]);
+  return {pid, fds[0], slot, -1};
+}
+
+// Runs each of tasks with run(task) and hands the results to done as
+// they come in, across NUM_WORKERS processes, or in order in this one
+// without workers. Tasks are handed out one at a time, so faster
+// workers take more of them. Result goes over a socket as it is, so it
+// must be trivially copyable. When a worker dies its task goes back on
+// the queue and a replacement is forked; a task that has taken down
+// MAX_TASK_ATTEMPTS workers is given up on rather than run here, where
+// it would likely take this process down too. Returns the tasks given
+// up on. describe names a task in the messages about them.
+template <typename Result>
+std::vector<int> run_sharded(const std::vector<int>& tasks,
+		 const std::function<Result(int)>& run,
+		 const std::function<void(int, const Result&)>& done,
+		 const std::function<std::string(int)>& describe) {
+  std::vector<int> failed;
+  if (NUM_WORKERS == 0 || tasks.size() < 2) {
+    for (int task : tasks) {
+      done(task, run(task));
+    }
+    return failed;
+  }
+  struct Reply {
+    int task;
+    Result result;
+  };
+  // Reads tasks until told to stop (-1 or EOF) and writes back results.
+  auto serve = [&](int fd) {
+    int task;
+    while (read_full(fd, &task, sizeof(task)) && task >= 0) {
+      const Reply reply = {task, run(task)};
+      if (!send_full(fd, &reply, sizeof(reply))) {
+	break;
+      }
+    }
+  };
+  // Workers read their node's replica, which lacks whatever this
+  // process has put in the primary copy since it was made.
+  refresh_colors_replicas(DICTIONARY.get());
+  std::deque<int> pending(tasks.begin(), tasks.end());
+  std::unordered_map<int, int> attempts;
+  const int num_workers = std::min<int>(NUM_WORKERS, pending.size());
+  std::vector<Worker> workers;
+  for (int i = 0; i < num_workers; i++) {
+    workers.push_back(fork_worker(workers, workers.size(), serve));
+  }
+  int remaining = pending.size();
+  while (remaining > 0) {
+    for (Worker& worker : workers) {
+      if (worker.task < 0 && !pending.empty()) {
+	worker.task = pending.front();
+	pending.pop_front();
+	attempts[worker.task]++;
+	// A failed send is picked up as a hangup by poll() below.
+	send_full(worker.fd, &worker.task, sizeof(worker.task));
+      }
+    }
+    std::vector<pollfd> fds;
+    for (const Worker& worker : workers) {
+      fds.push_back({worker.fd, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      perror("poll");
+      exit(1);
+    }
+    for (int i = workers.size() - 1; i >= 0; i--) {
+      if (fds[i].revents == 0) {
+	continue;
+      }
+      Worker& worker = workers[i];
+      Reply reply;
+      if (read_full(worker.fd, &reply, sizeof(reply)) && reply.task == worker.task) {
+	worker.task = -1;
+	remaining--;
+	done(reply.task, reply.result);
+	continue;
+      }
+      // The worker died, taking its task with it.
+      int status;
+      close(worker.fd);
+      waitpid(worker.pid, &status, 0);
+      fprintf(stderr, "Worker %d died (status %d)", worker.pid, status);
+      const int task = worker.task;
+      const int slot = worker.slot;
+      workers.erase(workers.begin() + i);
+      if (task >= 0) {
+	if (attempts[task] < MAX_TASK_ATTEMPTS) {
+	  fprintf(stderr, ", retrying %s.\n", describe(task).c_str());
+	  pending.push_front(task);
+	} else {
+	  fprintf(stderr, ", giving up on %s.\n", describe(task).c_str());
+	  remaining--;
+	  failed.push_back(task);
+	}
+      } else {
+	fprintf(stderr, ".\n");
+      }
+      if (!pending.empty()) {
+	workers.push_back(fork_worker(workers, slot, serve));
+      }
+    }
+  }
+  for (const Worker& worker : workers) {
+    close(worker.fd);  // The worker sees EOF and exits.
+    waitpid(worker.pid, nullptr, 0);
+  }
+  return failed;
+}
+
+// Append-only record of finished root candidates, so a search that is
+// killed can skip them when rerun with the same inputs. The first line
+// holds the key the file was written for, then one line per candidate
+// and one per improvement of the best score:
+//   key <key>
+//   candidate <guess> <score>
+//   best <guess> <score>
+class Checkpoint {
+public:
+  Checkpoint(const std::string& path, const std::string& key) {
+    std::vector<std::string> lines;
+    if (FILE* in = fopen(path.c_str(), "r")) {
+      char buf[1024];
+      // Only keep whole lines; the last one may be cut off by a kill.
+      while (fgets(buf, sizeof(buf), in) && strchr(buf, '\n')) {
+	lines.push_back(buf);
+      }
+      fclose(in);
+    }
+    if (!lines.empty() && lines[0] != "key " + key + "\n") {
+      printf("Ignoring checkpoint %s written for other inputs.\n", path.c_str());
+      lines.clear();
+    }
+    for (int i = 1; i < lines.size(); i++) {
+      char word[WORD_LENGTH + 1];
+      double score;
+      if (sscanf(lines[i].c_str(), "candidate %5s %lf", word, &score) == 2 &&
+	  std::isfinite(score)) {
+	completed_[lookup_guess(word)] = score;
+      }
+    }
+    // Rewrite rather than append so a truncated tail doesn't run into
+    // the next record.
+    const std::string tmp_path = path + ".tmp";
+    file_ = fopen(tmp_path.c_str(), "w");
+    if (file_ == nullptr) {
+      perror(tmp_path.c_str());
+      exit(1);
+    }
+    fprintf(file_, "key %s\n", key.c_str());
+    for (const auto& entry : completed_) {
+      write_candidate(entry.first, entry.second);
+    }
+    sync();
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+      perror(path.c_str());
+      exit(1);
+    }
+    if (!completed_.empty()) {
+      printf("Resuming from %s: %d candidates done.\n", path.c_str(), completed_.size());
+    }
+  }
+
+  ~Checkpoint() {
+    fclose(file_);
+  }
+
+  // Scores recorded so far, by guess index.
+  const std::unordered_map<int, double>& completed() const {
+    return completed_;
+  }
+
+  // Scores that aren't finite aren't kept, so a resumed search tries
+  // the guess again rather than skipping it for good.
+  void record(int guess, double score) {
+    if (!std::isfinite(score)) {
+      return;
+    }
+    completed_[guess] = score;
+    write_candidate(guess, score);
+    sync();
+  }
+
+private:
+  void write_candidate(int guess, double score) {
+    fprintf(file_, "candidate %s %.17g\n", GUESSES[guess].c_str(), score);
+    if (best_guess_ < 0 || score < best_score_) {
+      best_guess_ = guess;
+      best_score_ = score;
+      fprintf(file_, "best %s %.17g\n", GUESSES[guess].c_str(), score);
+    }
+  }
+
+  void sync() {
+    fflush(file_);
+    fsync(fileno(file_));
+  }
+
+  FILE* file_ = nullptr;
+  std::unordered_map<int, double> completed_;
+  int best_guess_ = -1;
+  double best_score_ = 0;
+};
+
+// Scores each of the candidates and reports them through done, sharded
+// across NUM_WORKERS processes. Candidates already in the checkpoint
+// are reported without being searched again, and new results are added
+// to it. Returns the indices of candidates whose workers kept dying,
+// which get no score.
+std::vector<int> score_candidates(const std::vector<int>& candidates,
+		      const std::vector<int>& guesses,
+		      const std::vector<int>& answers,
+		      int depth,
+		      int max_depth,
+		      Checkpoint* checkpoint,
+		      const CandidateCallback& done) {
+  std::vector<int> pending;
+  for (int i = 0; i < candidates.size(); i++) {
+    if (checkpoint != nullptr) {
+      auto iter = checkpoint->completed().find(candidates[i]);
+      if (iter != checkpoint->completed().end()) {
+	done(i, iter->second);
+	continue;
+      }
+    }
+    pending.push_back(i);
+  }
+  return run_sharded<double>(pending, [&](int i) {
+    return score_guess_steps(candidates[i], guesses, answers, depth, max_depth);
+  }, [&](int i, double score) {
+    if (checkpoint != nullptr) {
+      checkpoint->record(candidates[i], score);
+    }
+    done(i, score);
+  }, [&](int i) {
+    return std::string(GUESSES[candidates[i]].c_str());
+  });
+}
+
+// Endgame tablebase: the best guess and its exact expected number of
+// further guesses for small answer sets, built offline by
+// build_tablebase() and loaded by --tablebase. Entries are keyed by the
+// answer words, so they don't depend on indices. Only read during
+// searches, so it's shared by every thread.
+constexpr int TABLEBASE_MAX_ANSWERS = 20;
+
+struct TablebaseEntry {
+  std::vector<std::string> answers;  // Sorted.
+  Word guess;
+  double score;
+};
+
+// By tablebase_key(), which answer sets can share.
+std::unordered_multimap<uint64_t, TablebaseEntry> TABLEBASE;
+// Identifies the loaded tablebase's contents, or empty if none is.
+std::string TABLEBASE_KEY;
+
+// Same for any order of words: a sum of their FNV-1a hashes, each mixed
+// so the sum doesn't cancel.
+uint64_t tablebase_key(const std::vector<std::string>& words) {
+  uint64_t key = words.size();
+  for (const std::string& word : words) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : word) {
+      hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    key += hash;
+  }
+  return key;
+}
+
+// The words of answers, sorted, as TABLEBASE stores them.
+std::vector<std::string> tablebase_words(const std::vector<int>& answers) {
+  std::vector<std::string> words;
+  for (int answer : answers) {
+    words.push_back(ANSWERS[answer].c_str());
+  }
+  std::sort(words.begin(), words.end());
+  return words;
+}
+
+// Looks answers up in TABLEBASE. Entries whose guess isn't in this
+// dictionary are ignored.
+bool lookup_tablebase(const std::vector<int>& answers, std::pair<int, double>* result) {
+  const std::vector<std::string> words = tablebase_words(answers);
+  auto range = TABLEBASE.equal_range(tablebase_key(words));
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    if (iter->second.answers != words) {
+      continue;
+    }
+    const int guess = find_guess(iter->second.guess.c_str());
+    if (guess < 0) {
+      return false;
+    }
+    *result = {guess, iter->second.score};
+    return true;
+  }
+  return false;
+}
+
+// The best guess for answers when it takes no search: the answer
+// itself when there's one left, or what the tablebase has.
+bool known_best_guess(const std::vector<int>& answers, std::pair<int, double>* result) {
+  if (answers.size() == 1) {
+    *result = {ANSWER_GUESSES[answers[0]], 0.0};
+    return true;
+  }
+  return answers.size() <= TABLEBASE_MAX_ANSWERS && !TABLEBASE.empty() &&
+    lookup_tablebase(answers, result);
+}
+
+// best_guess()'s shallow pass: score_guess() of each guess that could
+// be worth searching, keeping those under a threshold as scores, best
+// first, and as the pool the children search. Runs a guess per step(),
+// so ResumableSearch can stop in the middle, except at wide roots with
+// --successive_halving, which take one step. At the root it reuses
+// ROOT_SCORES when they're for answers.
+class ShallowPass {
+public:
+  ShallowPass(const std::vector<int>& guesses, const std::vector<int>& answers, int depth)
+    : guesses_(guesses), answers_(answers), threshold_(0.8 * answers.size()),
+      letters_(informative_letters(answers)),
+      root_scores_(depth == 0 && ROOT_SCORES && ROOT_SCORES->answers() == answers ?
+		   ROOT_SCORES.get() : nullptr),
+      halving_(depth == 0 && SUCCESSIVE_HALVING && answers.size() >= HALVING_MIN_ANSWERS &&
+	       root_scores_ == nullptr) {}
+
+  // Scores the next guess, or all of them by successive halving.
+  // Returns whether the pass is done, after which scores are sorted.
+  bool step() {
+    if (halving_) {
+      std::vector<int> informative_guesses;
+      for (int guess : guesses_) {
+	if ((GUESS_LETTER_MASKS[guess] & letters_) != 0) {
+	  informative_guesses.push_back(guess);
+	}
+      }
+      shallow_scores_halving(informative_guesses, answers_, threshold_,
+			     &scores, &worthwhile_guesses);
+      next_guess_ = guesses_.size();
+    } else if (next_guess_ < guesses_.size()) {
+      score(guesses_[next_guess_++]);
+    }
+    if (next_guess_ < guesses_.size()) {
+      return false;
+    }
+    std::sort(scores.begin(), scores.end(), [](auto &left, auto &right) {
+      return left.second < right.second;
+    });
+    return true;
+  }
+
+  std::vector<std::pair<int, double>> scores;
+  std::vector<int> worthwhile_guesses;
+
+private:
+  void score(int guess) {
+    if (!scores.empty() && (GUESS_LETTER_MASKS[guess] & letters_) == 0) {
+      // Would score answers.size(), which is over the threshold. Since
+      // subsets only get smaller, this also keeps the guess out of the
+      // pool the children search.
+      return;
+    }
+    double score = root_scores_ ? root_scores_->score(guess) : -1;
+    if (score < 0) {
+      score = score_guess(guess, guesses_, answers_);
+    }
+    if (scores.empty() || (score < threshold_)) {
+      scores.push_back({guess, score});
+      worthwhile_guesses.push_back(guess);
+    }
+  }
+
+  const std::vector<int>& guesses_;
+  const std::vector<int>& answers_;
+  const double threshold_;
+  const int letters_;
+  const ShallowScores* const root_scores_;
+  const bool halving_;
+  int next_guess_ = 0;
+};
+
+// The guess at max_depth, from its sorted shallow scores.
+std::pair<int, double> leaf_guess(const std::vector<std::pair<int, double>>& shallow_scores,
+				  const std::vector<int>& answers) {
+  if (!LEAF_ESTIMATOR) {
+    return shallow_scores[0];
+  }
+  // Turn the best few shallow scores, and the answers themselves when
+  // there are only a few, into estimated steps.
+  std::vector<int> leaf_guesses;
+  for (int i = 0; i < shallow_scores.size() && i < LEAF_CANDIDATES; i++) {
+    leaf_guesses.push_back(shallow_scores[i].first);
+  }
+  for (int i = 0; answers.size() <= 10 && i < answers.size(); i++) {
+    leaf_guesses.push_back(ANSWER_GUESSES[answers[i]]);
+  }
+  std::pair<int, double> best = {-1, 0};
+  for (int guess : leaf_guesses) {
+    const double score = estimate_steps(guess, answers);
+    if (best.first < 0 || score < best.second) {
+      best = {guess, score};
+    }
+  }
+  return best;
+}
+
+// The guesses to search fully, from the sorted shallow scores.
+std::vector<int> search_candidates(const std::vector<std::pair<int, double>>& shallow_scores,
+				   const std::vector<int>& answers) {
+  std::vector<int> candidates;
+  auto iter = shallow_scores.begin();
+  for (int i = 0;
+       iter != shallow_scores.end() && i < MAX_CANDIDATES;
+       ++i) {
+    if (answers.size() <= 10 && i < answers.size()) {
+      // If there's only a few answers left, always try to guess them
+      // first.
+      candidates.push_back(ANSWER_GUESSES[answers[i]]);
+    } else {
+      candidates.push_back(iter->first);
+      ++iter;
+    }
+  }
+  return candidates;
+}
+
+// Returns guess index, score.
+// Score is expected number of steps until solved.
+std::pair<int, double> best_guess(const std::vector<int>& guesses,
+				  const std::vector<int>& answers,
+				  int depth, int max_depth,
+				  Checkpoint* checkpoint) {
+  assert(!answers.empty());
+  std::pair<int, double> solved;
+  if (known_best_guess(answers, &solved)) {
+    return solved;
+  }
+  if (depth == 0 && VERBOSE) {
+    printf("Computing shallow scores.\n");
+  }
+  ShallowPass pass(guesses, answers, depth);
+  while (!pass.step()) {
+  }
+  if (depth == 0 && VERBOSE) {
+    printf("Done computing shallow scores. %d candidates.\n", pass.scores.size());
+  }
+
+  if (depth == max_depth) {
+    return leaf_guess(pass.scores, answers);
+  }
+
+  // Only the first small node on a path gathers one; below it every
+  // subset is covered already.
+  std::unique_ptr<SubMatrix> submatrix;
+  if (SUBMATRIX == nullptr && answers.size() <= SUBMATRIX_MAX_ANSWERS) {
+    submatrix.reset(new SubMatrix(pass.worthwhile_guesses, answers));
+  }
+
+  const std::vector<int>& worthwhile_guesses = pass.worthwhile_guesses;
+  const std::vector<int> candidates = search_candidates(pass.scores, answers);
+
+  if (depth > 0) {
+    int best_guess;
+    double best_score = 1000000;
+    for (int guess : candidates) {
+      double score = score_guess_steps(guess, worthwhile_guesses, answers, depth, max_depth);
+      if (score < best_score) {
+	best_guess = guess;
+	best_score = score;
+      }
+    }
+    return {best_guess, best_score};
+  }
+
+  // At the root candidates may finish out of order, so ties go to the
+  // earlier candidate like they would in the loop above.
+  int best_index = -1;
+  double best_score = 1000000;
+  int num_done = 0;
+  score_candidates(candidates, worthwhile_guesses, answers, depth, max_depth, checkpoint,
+		   [&](int i, double score) {
+    if (VERBOSE) {
+      printf("Candidate %03d/%03d: %s  %g\n", num_done++, MAX_CANDIDATES,
+	     GUESSES[candidates[i]].c_str(), score);
+    }
+    if (score < best_score || (score == best_score && i < best_index)) {
+      best_index = i;
+      best_score = score;
+      if (VERBOSE) {
+	printf("  New best: %s - %g\n", GUESSES[candidates[best_index]].c_str(), best_score);
+      }
+    }
+  });
+  if (best_index < 0) {
+    // Candidates whose workers died are skipped; only losing them all
+    // leaves nothing to play.
+    fprintf(stderr, "Every candidate's search died.\n");
+    exit(1);
+  }
+  return {candidates[best_index], best_score};
+}
+
+// FNV-1a, as hex. Used to name files after keys.
+std::string hash_key(const std::string& key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : key) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+  }
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+  return hex;
+}
+
+// The words of table in word list order, given each one's position,
+// or in table order if positions is empty.
+std::string words_in_list_order(const Table<Word>& table, const std::vector<int>& positions) {
+  std::vector<const char*> list(table.size());
+  for (int i = 0; i < table.size(); i++) {
+    list[positions.empty() ? i : positions[i]] = table[i].c_str();
+  }
+  std::string words;
+  for (const char* word : list) {
+    words += word;
+  }
+  return words;
+}
+
+// Identifies the word lists, so results computed for one dictionary
+// aren't reused for another. The words go in list order, so the key
+// stays the same when reorder_dictionary() lays them out differently
+// and files that refer to words, like guess pools, still apply.
+std::string dictionary_key() {
+  const std::string words = words_in_list_order(GUESSES, DICTIONARY->guess_words) + "/" +
+    words_in_list_order(ANSWERS, DICTIONARY->answer_words);
+  return "guesses=" + std::to_string(GUESSES.size()) +
+    " answers=" + std::to_string(ANSWERS.size()) +
+    " words=" + hash_key(words);
+}
+
+// dictionary_key() plus the layout, for what's addressed by index.
+std::string layout_key() {
+  const std::vector<int>& guess_words = DICTIONARY->guess_words;
+  const std::vector<int>& answer_words = DICTIONARY->answer_words;
+  if (guess_words.empty()) {
+    return dictionary_key();
+  }
+  std::string positions(reinterpret_cast<const char*>(guess_words.data()),
+			guess_words.size() * sizeof(int));
+  positions.append(reinterpret_cast<const char*>(answer_words.data()),
+		   answer_words.size() * sizeof(int));
+  return dictionary_key() + " layout=" + hash_key(positions);
+}
+
+// Describes the options a search's result depends on, other than its
+// depth and inputs.
+std::string options_key() {
+  return "max_candidates=" + std::to_string(MAX_CANDIDATES) +
+    " leaf_estimator=" + std::to_string(LEAF_ESTIMATOR) +
+    " successive_halving=" + std::to_string(SUCCESSIVE_HALVING) +
+    " matrix_free=" + std::to_string(MATRIX_FREE) +
+    " tablebase=" + (TABLEBASE_KEY.empty() ? std::string("none") : TABLEBASE_KEY);
+}
+
+// Identifies GUESS_POOL by its words, not just how many there are.
+std::string guess_pool_key() {
+  if (GUESS_POOL.empty()) {
+    return "all";
+  }
+  std::string words;
+  for (int guess : GUESS_POOL) {
+    words += GUESSES[guess].c_str();
+  }
+  return std::to_string(GUESS_POOL.size()) + ":" + hash_key(words);
+}
+
+// Describes everything a root search's result depends on.
+std::string search_key(const std::vector<Outcome>& outcomes, int max_depth) {
+  std::string key = "max_depth=" + std::to_string(max_depth) +
+    " " + options_key() +
+    " guess_pool=" + guess_pool_key() +
+    " " + dictionary_key();
+  for (const Outcome& outcome : outcomes) {
+    key += std::string(" ") + GUESSES[outcome.first].c_str() + ":" +
+      lookup_colors(outcome.second);
+  }
+  return key;
+}
+
+// Splits answers by the colors guess gets, as (colors, answers) with
+// the largest bucket first. Ties go to the lower colors index.
+std::vector<std::pair<int, std::vector<int>>> split_answers(int guess,
+							    const std::vector<int>& answers) {
+  std::vector<int> colors(answers.size());
+  colors_row(guess, answers.data(), answers.size(), colors.data());
+  std::map<int, std::vector<int>> buckets;
+  for (int i = 0; i < answers.size(); i++) {
+    buckets[colors[i]].push_back(answers[i]);
+  }
+  std::vector<std::pair<int, std::vector<int>>> sorted(buckets.begin(), buckets.end());
+  std::stable_sort(sorted.begin(), sorted.end(), [](auto &left, auto &right) {
+    return left.second.size() > right.second.size();
+  });
+  return sorted;
+}
+
+// Answer sets kept from speculative searches.
+constexpr int SPECULATION_CACHE_SIZE = 64;
+
+// Searches the states the last suggestion can lead to while the player
+// is busy entering it, so the next solve() usually finds its answer
+// ready. The buckets the suggested guess splits the answers into are
+// searched largest, i.e. most likely, first, in a forked process: the
+// foreground stays free and the two never share mutable state. Results
+// go to a small cache keyed by answer set. When the next request
+// comes in, whatever has arrived is collected and the speculation is
+// killed, unless it is partway through exactly the state asked for, in
+// which case it is allowed to finish that one.
+class Speculator {
+public:
+  ~Speculator() { cancel(-1); }
+
+  void start(int guess, const std::vector<int>& answers, int max_depth) {
+    cancel(-1);
+    buckets_.clear();
+    for (auto& bucket : split_answers(guess, answers)) {
+      if (bucket.first != 682 && bucket.second.size() > 1) {
+	buckets_.push_back(std::move(bucket.second));
+      }
+    }
+    max_depth_ = max_depth;
+    if (buckets_.empty()) {
+      return;
+    }
+    const Worker worker = fork_worker({}, -1, [&](int fd) {
+      VERBOSE = false;
+      TRACER = nullptr;
+      const std::vector<int> guesses = search_guesses();
+      for (int i = 0; i < buckets_.size(); i++) {
+	Result started = {i, -1, 0};
+	send_full(fd, &started, sizeof(started));
+	auto result = best_guess(guesses, buckets_[i], 0, max_depth);
+	Result done = {i, result.first, result.second};
+	if (!send_full(fd, &done, sizeof(done))) {
+	  break;
+	}
+      }
+    });
+    pid_ = worker.pid;
+    fd_ = worker.fd;
+    in_progress_ = -1;
+  }
+
+  // Stops the speculation and returns the search of answers if it
+  // produced one.
+  bool lookup(const std::vector<int>& answers, int max_depth, std::pair<int, double>* result) {
+    const std::string key = std::to_string(max_depth) + ":" + subset_key(answers);
+    int wanted = -1;
+    for (int i = 0; i < buckets_.size() && max_depth == max_depth_; i++) {
+      if (buckets_[i] == answers) {
+	wanted = i;
+      }
+    }
+    cancel(wanted);
+    auto iter = cache_.find(key);
+    if (iter == cache_.end()) {
+      return false;
+    }
+    *result = iter->second;
+    return true;
+  }
+
+private:
+  struct Result {
+    int bucket;
+    int guess;  // -1 when the bucket has just been started.
+    double score;
+  };
+
+  // Collects finished results and kills the process, after waiting for
+  // bucket wanted if it's the one in progress.
+  void cancel(int wanted) {
+    if (pid_ < 0) {
+      return;
+    }
+    while (true) {
+      pollfd fd = {fd_, POLLIN, 0};
+      const bool wait = wanted >= 0 && in_progress_ == wanted;
+      if (poll(&fd, 1, wait ? -1 : 0) <= 0) {
+	break;
+      }
+      Result result;
+      if (!read_full(fd_, &result, sizeof(result))) {
+	break;
+      }
+      if (result.guess < 0) {
+	in_progress_ = result.bucket;
+	continue;
+      }
+      in_progress_ = -1;
+      if (cache_.size() >= SPECULATION_CACHE_SIZE) {
+	cache_.erase(order_.front());
+	order_.pop_front();
+      }
+      const std::string key =
+	std::to_string(max_depth_) + ":" + subset_key(buckets_[result.bucket]);
+      if (cache_.insert({key, {result.guess, result.score}}).second) {
+	order_.push_back(key);
+      }
+    }
+    kill(pid_, SIGKILL);
+    waitpid(pid_, nullptr, 0);
+    close(fd_);
+    pid_ = -1;
+    fd_ = -1;
+  }
+
+  pid_t pid_ = -1;
+  int fd_ = -1;
+  int max_depth_ = -1;
+  int in_progress_ = -1;
+  std::vector<std::vector<int>> buckets_;
+  std::unordered_map<std::string, std::pair<int, double>> cache_;
+  std::deque<std::string> order_;  // Cache keys, oldest first.
+};
+
+// Set by --speculate.
+thread_local Speculator* SPECULATOR = nullptr;
+
+int solve(const std::vector<Outcome>& outcomes, int max_depth) {
+  const std::vector<int> all_answers = all_answer_indices();
+  std::vector<int> answers_left = filter_answers(all_answers, outcomes);
+  printf("Num possible answers: %d\n", answers_left.size());
+  
+  if (answers_left.empty()) {
+    printf("No POSSIBLE ANSWERS\n");
+    return 0;
+  }
+
+  if (answers_left.size() <= 5) {
+    printf("POSSIBLE ANSWERS:");
+    for (int answer : answers_left) {
+      printf(" '%s'", ANSWERS[answer].c_str());
+    }
+    printf("\n");
+  }
+
+  std::pair<int, double> result;
+  if (SPECULATOR && SPECULATOR->lookup(answers_left, max_depth, &result)) {
+    printf("Searched ahead.\n");
+  } else {
+    const std::vector<int> all_guesses = search_guesses();
+    if (INCREMENTAL_SCORES) {
+      if (ROOT_SCORES && ROOT_SCORES->guesses() == all_guesses &&
+	  ROOT_SCORES->covers(answers_left)) {
+	ROOT_SCORES->narrow(answers_left);
+      } else {
+	ROOT_SCORES.reset(new ShallowScores(all_guesses, answers_left));
+      }
+    }
+    std::unique_ptr<Checkpoint> checkpoint;
+    if (!CHECKPOINT_DIR.empty()) {
+      const std::string key = search_key(outcomes, max_depth);
+      checkpoint.reset(new Checkpoint(CHECKPOINT_DIR + "/" + hash_key(key) + ".ckpt", key));
+    }
+    if (TRACER) {
+      TRACER->push("root[" + std::to_string(answers_left.size()) + "]");
+    }
+    result = best_guess(all_guesses, answers_left, 0, max_depth, checkpoint.get());
+    if (TRACER) {
+      TRACER->pop();
+    }
+  }
+  printf("%s  %g\n", GUESSES[result.first].c_str(), result.second);
+  if (SPECULATOR) {
+    SPECULATOR->start(result.first, answers_left, max_depth);
+  }
+  return result.first;
+}
+
+// Worst-case search. Instead of the expected number of guesses, these
+// look for a strategy that solves every answer within k guesses,
+// either whichever answer it is (worst_case_within) or against an
+// Absurdle-style host that always keeps the largest bucket
+// (absurdle_within). Each node only tries the MINIMAX_CANDIDATES
+// guesses with the smallest largest bucket, so a strategy that is
+// found is a guarantee but failing to find one is not a proof there
+// is none.
+constexpr int MINIMAX_CANDIDATES = 50;
+
+// What is known about an answer subset: it is solvable within
+// solvable guesses (with guess first) and not within unsolvable.
+struct MinimaxBounds {
+  int solvable = INT_MAX;
+  int unsolvable = 0;
+  int guess = -1;
+};
+
+// Bounds by subset_key() of the answers. A bound only holds for the
+// guesses it was found with, so there's one of these per
+// minimax_memo_key().
+using MinimaxMemo = std::unordered_map<std::string, MinimaxBounds>;
+thread_local std::unordered_map<std::string, MinimaxMemo> WORST_CASE_MEMO;
+thread_local std::unordered_map<std::string, MinimaxMemo> ABSURDLE_MEMO;
+
+void clear_minimax_memos() {
+  WORST_CASE_MEMO.clear();
+  ABSURDLE_MEMO.clear();
+}
+
+// Identifies the dictionary and the guesses a worst-case search may
+// make.
+std::string minimax_memo_key(const std::vector<int>& guesses) {
+  return layout_key() + " guesses=" +
+    hash_key(std::string(reinterpret_cast<const char*>(guesses.data()),
+			 guesses.size() * sizeof(int)));
+}
+
+// A search context: a dictionary, which any number of solvers may
+// share, and the mutable state of the searches run with it. While a
+// Solver::Scope is alive its solver is the calling thread's, and the
+// engine's functions all work on it. Threads that each bind their own
+// solver search concurrently without locks. A solver is bound to one
+// thread at a time. Options like --workers and MAX_CANDIDATES are
+// process-wide and only set at startup.
+class Solver {
+public:
+  explicit Solver(std::shared_ptr<Dictionary> dictionary)
+    : dictionary_(std::move(dictionary)) {}
+
+  class Scope {
+  public:
+    explicit Scope(Solver* solver) : solver_(solver) { solver_->swap(); }
+    ~Scope() { solver_->swap(); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Solver* solver_;
+  };
+
+  long long cache_hits() const { return cache_hits_; }
+  long long cache_misses() const { return cache_misses_; }
+
+private:
+  // Exchanges this solver's state with the thread's, so the second call
+  // gives the thread back what it had.
+  void swap() {
+    std::shared_ptr<Dictionary> dictionary = std::move(dictionary_);
+    dictionary_ = std::move(DICTIONARY);
+    bind_dictionary(std::move(dictionary));
+    std::swap(guess_pool_, GUESS_POOL);
+    std::swap(cache_hits_, CACHE_HITS);
+    std::swap(cache_misses_, CACHE_MISSES);
+    std::swap(worst_case_memo_, WORST_CASE_MEMO);
+    std::swap(absurdle_memo_, ABSURDLE_MEMO);
+    std::swap(tile_store_, TILE_STORE);
+    std::swap(tracer_, TRACER);
+    std::swap(root_scores_, ROOT_SCORES);
+    std::swap(verbose_, VERBOSE);
+  }
+
+  std::shared_ptr<Dictionary> dictionary_;
+  std::vector<int> guess_pool_;
+  long long cache_hits_ = 0;
+  long long cache_misses_ = 0;
+  std::unordered_map<std::string, MinimaxMemo> worst_case_memo_;
+  std::unordered_map<std::string, MinimaxMemo> absurdle_memo_;
+  std::unique_ptr<TileStore> tile_store_;
+  Tracer* tracer_ = nullptr;
+  std::unique_ptr<ShallowScores> root_scores_;
+  bool verbose_ = false;  // Solvers search quietly.
+};
+
+// best_guess() as a search that can stop after any number of steps and
+// pick up where it left off, possibly on another thread. The recursion
+// is kept on an explicit stack of frames, so a search in progress is
+// just this object. Each frame goes through the same shallow pass,
+// leaf pick and candidates as a sequential best_guess(); only the
+// root's workers and checkpoints are left out, and nothing is printed.
+// It runs on whatever dictionary and state are bound when step() is
+// called, which must be the same each time.
+class ResumableSearch {
+public:
+  ResumableSearch(const std::vector<int>& guesses, const std::vector<int>& answers,
+		  int max_depth)
+    : max_depth_(max_depth) {
+    assert(!answers.empty());
+    push(guesses, answers, 0);
+  }
+
+  ~ResumableSearch() {
+    // Frames' submatrices clear SUBMATRIX, which isn't theirs here.
+    const SubMatrix* outer = SUBMATRIX;
+    stack_.clear();
+    SUBMATRIX = outer;
+    for (; TRACER && trace_depth_ > 0; trace_depth_--) {
+      TRACER->pop();
+    }
+  }
+
+  bool done() const { return stack_.empty(); }
+  const std::pair<int, double>& result() const { return result_; }
+
+  // Runs until the search is done or max_nodes nodes have been taken,
+  // counting each guess scored and each node entered as one. Returns
+  // done().
+  bool step(long long max_nodes) {
+    const SubMatrix* outer = SUBMATRIX;
+    SUBMATRIX = nullptr;
+    for (const std::unique_ptr<Frame>& frame : stack_) {
+      if (frame->submatrix) {
+	SUBMATRIX = frame->submatrix.get();
+      }
+    }
+    for (long long nodes = 0; !stack_.empty() && nodes < max_nodes; nodes++) {
+      advance(*stack_.back());
+    }
+    SUBMATRIX = outer;
+    return done();
+  }
+
+private:
+  enum Phase { START, SHALLOW, CANDIDATES };
+
+  struct Frame {
+    std::vector<int> guesses;
+    std::vector<int> answers;
+    int depth;
+    Phase phase = START;
+
+    std::unique_ptr<ShallowPass> pass;
+    std::unique_ptr<SubMatrix> submatrix;
+
+    std::vector<int> candidates;
+    int next_candidate = 0;
+    int best_guess = -1;
+    double best_score = 1000000;
+
+    // The candidate being scored: its colors against answers, its
+    // buckets in score_guess_steps()'s order, and the sum so far.
+    std::vector<int> colors;
+    std::vector<std::pair<int, int>> buckets;
+    int next_bucket = 0;
+    double expected_score = 0;
+  };
+
+  void push(const std::vector<int>& guesses, const std::vector<int>& answers, int depth) {
+    stack_.emplace_back(new Frame);
+    stack_.back()->guesses = guesses;
+    stack_.back()->answers = answers;
+    stack_.back()->depth = depth;
+  }
+
+  void trace_push(const std::string& frame) {
+    if (TRACER) {
+      TRACER->push(frame);
+      trace_depth_++;
+    }
+  }
+
+  void trace_pop() {
+    if (TRACER && trace_depth_ > 0) {
+      TRACER->pop();
+      trace_depth_--;
+    }
+  }
+
+  // Pops the top frame with its result, handing it to the bucket of its
+  // parent that pushed it.
+  void finish(const std::pair<int, double>& result) {
+    stack_.pop_back();
+    if (stack_.empty()) {
+      result_ = result;
+      return;
+    }
+    trace_pop();
+    Frame& parent = *stack_.back();
+    const double prob = parent.buckets[parent.next_bucket].second /
+      static_cast<double>(parent.answers.size());
+    parent.expected_score += prob * (result.second + 1.0);
+    parent.next_bucket++;
+  }
+
+  void start_candidate(Frame& frame) {
+    if (frame.next_candidate == frame.candidates.size()) {
+      finish({frame.best_guess, frame.best_score});
+      return;
+    }
+    const int guess = frame.candidates[frame.next_candidate];
+    trace_push(GUESSES[guess].c_str());
+    frame.buckets = count_colors(guess, frame.answers, &frame.colors);
+    frame.next_bucket = 0;
+    frame.expected_score = 0;
+  }
+
+  // One unit of work on the top frame.
+  void advance(Frame& frame) {
+    const std::vector<int>& answers = frame.answers;
+    if (frame.phase == START) {
+      std::pair<int, double> solved;
+      if (known_best_guess(answers, &solved)) {
+	finish(solved);
+      } else {
+	frame.pass.reset(new ShallowPass(frame.guesses, answers, frame.depth));
+	frame.phase = SHALLOW;
+      }
+      return;
+    }
+
+    if (frame.phase == SHALLOW) {
+      if (!frame.pass->step()) {
+	return;
+      }
+      if (frame.depth == max_depth_) {
+	finish(leaf_guess(frame.pass->scores, answers));
+	return;
+      }
+      if (SUBMATRIX == nullptr && answers.size() <= SUBMATRIX_MAX_ANSWERS) {
+	frame.submatrix.reset(new SubMatrix(frame.pass->worthwhile_guesses, answers));
+      }
+      frame.candidates = search_candidates(frame.pass->scores, answers);
+      frame.phase = CANDIDATES;
+      start_candidate(frame);
+      return;
+    }
+
+    // CANDIDATES: go through the current candidate's buckets, stopping
+    // at the first that needs a search of its own.
+    for (; frame.next_bucket < frame.buckets.size(); frame.next_bucket++) {
+      const int bucket_colors = frame.buckets[frame.next_bucket].first;
+      const int remaining = frame.buckets[frame.next_bucket].second;
+      if (bucket_colors != 682 && frame.depth < max_depth_) {
+	trace_push(bucket_frame(bucket_colors, remaining));
+	push(frame.pass->worthwhile_guesses, bucket_answers(answers, frame.colors, bucket_colors),
+	     frame.depth + 1);
+	return;
+      }
+      frame.expected_score += remaining / static_cast<double>(answers.size()) *
+	unsearched_bucket_score(bucket_colors, remaining, frame.depth);
+    }
+    trace_pop();
+    if (frame.expected_score < frame.best_score) {
+      frame.best_guess = frame.candidates[frame.next_candidate];
+      frame.best_score = frame.expected_score;
+    }
+    frame.next_candidate++;
+    start_candidate(frame);
+  }
+
+  int max_depth_;
+  std::vector<std::unique_ptr<Frame>> stack_;
+  std::pair<int, double> result_ = {-1, 0};
+  int trace_depth_ = 0;  // Frames this search has open on TRACER.
+};
+
+// Runs searches for many sessions on a few threads, slice_nodes nodes
+// at a time, taking turns in the order they were submitted. A search
+// that needs a lot of nodes can't hold up one that needs few, and any
+// search can be cancelled between slices. Each session searches with a
+// Solver of its own, so sessions don't share search state, and is
+// dropped once its result is waited for or it's closed.
+class SearchScheduler {
+public:
+  SearchScheduler(int num_threads, long long slice_nodes) : slice_nodes_(slice_nodes) {
+    for (int i = 0; i < num_threads; i++) {
+      threads_.emplace_back([this, i]() {
+	enter_numa_node(i);
+	run();
+      });
+    }
+  }
+
+  ~SearchScheduler() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Starts a search of answers with dictionary's guesses, or the pool
+  // if given. Returns its id.
+  int submit(std::shared_ptr<Dictionary> dictionary, const std::vector<int>& guess_pool,
+	     const std::vector<int>& answers, int max_depth) {
+    std::shared_ptr<Session> session(new Session(std::move(dictionary)));
+    {
+      Solver::Scope scope(&session->solver);
+      GUESS_POOL = guess_pool;
+      session->search.reset(new ResumableSearch(search_guesses(), answers, max_depth));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    session->id = next_id_++;
+    sessions_[session->id] = session;
+    queue_.push_back(session);
+    wake_.notify_one();
+    return session->id;
+  }
+
+  // Stops search id after its current slice, unless it has finished
+  // or isn't one of this scheduler's. wait() then returns false.
+  void cancel(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = sessions_.find(id);
+    if (found != sessions_.end() && !found->second->finished) {
+      found->second->cancelled = true;
+    }
+  }
+
+  // Cancels search id like cancel() and forgets it, for searches whose
+  // result nobody will wait() for.
+  void close(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = sessions_.find(id);
+    if (found == sessions_.end()) {
+      return;
+    }
+    if (!found->second->finished) {
+      found->second->cancelled = true;
+    }
+    sessions_.erase(found);
+  }
+
+  // Waits for search id to finish and forgets it, so each search is
+  // waited for once. Returns false if it was cancelled before it could
+  // finish, or there's no such search.
+  bool wait(int id, std::pair<int, double>* result) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto found = sessions_.find(id);
+    if (found == sessions_.end()) {
+      return false;
+    }
+    std::shared_ptr<Session> session = found->second;
+    finished_.wait(lock, [&]() { return session->finished; });
+    sessions_.erase(id);
+    if (session->search == nullptr) {
+      return false;
+    }
+    *result = session->search->result();
+    return true;
+  }
+
+  // Searches submitted and not yet waited for or closed.
+  int num_sessions() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sessions_.size();
+  }
+
+private:
+  struct Session {
+    explicit Session(std::shared_ptr<Dictionary> dictionary) : solver(std::move(dictionary)) {}
+
+    int id = -1;
+    Solver solver;
+    std::unique_ptr<ResumableSearch> search;
+    bool cancelled = false;
+    bool finished = false;
+  };
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [&]() { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+	return;
+      }
+      std::shared_ptr<Session> session = queue_.front();
+      queue_.pop_front();
+      bool done = false;
+      if (!session->cancelled && !stopping_) {
+	lock.unlock();
+	{
+	  Solver::Scope scope(&session->solver);
+	  done = session->search->step(slice_nodes_);
+	}
+	lock.lock();
+      }
+      if (!done && (session->cancelled || stopping_)) {
+	session->cancelled = true;
+	Solver::Scope scope(&session->solver);
+	session->search.reset();
+      }
+      if (done || session->cancelled) {
+	session->finished = true;
+	finished_.notify_all();
+      } else {
+	queue_.push_back(session);
+	wake_.notify_one();
+      }
+    }
+  }
+
+  const long long slice_nodes_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable finished_;
+  std::deque<std::shared_ptr<Session>> queue_;
+  std::unordered_map<int, std::shared_ptr<Session>> sessions_;  // By id.
+  int next_id_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+// The guesses most worth trying for a worst-case bound: smallest
+// largest bucket, then most buckets, then answers first since they
+// might be right.
+std::vector<int> minimax_candidates(const std::vector<int>& guesses,
+				    const std::vector<int>& answers) {
+  const int letters = informative_letters(answers);
+  std::unordered_set<int> answer_guesses;
+  for (int answer : answers) {
+    answer_guesses.insert(ANSWER_GUESSES[answer]);
+  }
+  std::vector<std::pair<std::array<int, 3>, int>> ranked;
+  std::vector<int> colors(answers.size());
+  for (int guess : guesses) {
+    if ((GUESS_LETTER_MASKS[guess] & letters) == 0) {
+      continue;
+    }
+    colors_row(guess, answers.data(), answers.size(), colors.data());
+    std::array<int, 683> counts = {0};
+    int largest = 0;
+    int num_buckets = 0;
+    for (int c : colors) {
+      num_buckets += counts[c]++ == 0;
+      largest = std::max(largest, counts[c]);
+    }
+    ranked.push_back({{largest, -num_buckets, answer_guesses.count(guess) ? 0 : 1}, guess});
+  }
+  std::stable_sort(ranked.begin(), ranked.end(), [](auto &left, auto &right) {
+    return left.first < right.first;
+  });
+  std::vector<int> candidates;
+  for (int i = 0; i < ranked.size() && i < MINIMAX_CANDIDATES; i++) {
+    candidates.push_back(ranked[i].second);
+  }
+  return candidates;
+}
+
+// worst_case_within() with the bounds memo for guesses.
+bool worst_case_search(const std::vector<int>& guesses,
+		       const std::vector<int>& answers,
+		       int k, int* guess, MinimaxMemo* memo) {
+  if (answers.size() == 1) {
+    *guess = ANSWER_GUESSES[answers[0]];
+    return k >= 1;
+  }
+  if (k <= 1) {
+    return false;
+  }
+  MinimaxBounds& bounds = (*memo)[subset_key(answers)];
+  if (k >= bounds.solvable) {
+    *guess = bounds.guess;
+    return true;
+  }
+  if (k <= bounds.unsolvable) {
+    return false;
+  }
+  for (int candidate : minimax_candidates(guesses, answers)) {
+    const auto buckets = split_answers(candidate, answers);
+    if (k == 2 && buckets[0].second.size() > 1) {
+      continue;  // Candidates are sorted, but answers-first ties may follow.
+    }
+    bool ok = true;
+    for (const auto& bucket : buckets) {
+      int unused;
+      if (bucket.first != 682 &&
+	  !worst_case_search(guesses, bucket.second, k - 1, &unused, memo)) {
+	ok = false;
+	break;
+      }
+    }
+    if (ok) {
+      // The recursion may have rehashed the memo, so look it up again.
+      MinimaxBounds& solved = (*memo)[subset_key(answers)];
+      solved.solvable = k;
+      solved.guess = candidate;
+      *guess = candidate;
+      return true;
+    }
+  }
+  MinimaxBounds& failed = (*memo)[subset_key(answers)];
+  failed.unsolvable = std::max(failed.unsolvable, k);
+  return false;
+}
+
+// Whether every one of answers can be solved within k guesses. Sets
+// *guess to the guess to make if so. Buckets are checked largest
+// first and a guess is dropped at its first failing bucket. With one
+// guess left to spare, any bucket of two or more fails outright.
+bool worst_case_within(const std::vector<int>& guesses,
+		       const std::vector<int>& answers,
+		       int k, int* guess) {
+  return worst_case_search(guesses, answers, k, guess,
+			   &WORST_CASE_MEMO[minimax_memo_key(guesses)]);
+}
+
+// absurdle_within() with the bounds memo for guesses.
+bool absurdle_search(const std::vector<int>& guesses,
+		     const std::vector<int>& answers,
+		     int k, int* guess, MinimaxMemo* memo) {
+  if (answers.size() == 1) {
+    *guess = ANSWER_GUESSES[answers[0]];
+    return k >= 1;
+  }
+  if (k <= 1) {
+    return false;
+  }
+  const MinimaxBounds bounds = (*memo)[subset_key(answers)];
+  if (k >= bounds.solvable) {
+    *guess = bounds.guess;
+    return true;
+  }
+  if (k <= bounds.unsolvable) {
+    return false;
+  }
+  for (int candidate : minimax_candidates(guesses, answers)) {
+    const auto buckets = split_answers(candidate, answers);
+    const std::vector<int>& kept = buckets[0].second;
+    int unused;
+    if (kept.size() < answers.size() && absurdle_search(guesses, kept, k - 1, &unused, memo)) {
+      MinimaxBounds& solved = (*memo)[subset_key(answers)];
+      solved.solvable = k;
+      solved.guess = candidate;
+      *guess = candidate;
+      return true;
+    }
+  }
+  MinimaxBounds& failed = (*memo)[subset_key(answers)];
+  failed.unsolvable = std::max(failed.unsolvable, k);
+  return false;
+}
+
+// Whether the game can be won within k guesses against a host that
+// always answers with the largest bucket. Sets *guess if so.
+bool absurdle_within(const std::vector<int>& guesses,
+		     const std::vector<int>& answers,
+		     int k, int* guess) {
+  return absurdle_search(guesses, answers, k, guess,
+			 &ABSURDLE_MEMO[minimax_memo_key(guesses)]);
+}
+
+// Finds the fewest guesses, up to max_guesses, that are guaranteed to
+// solve the game from outcomes, by deepening one guess at a time.
+// Returns the guess to make, or -1 if none was found.
+int solve_worst_case(const std::vector<Outcome>& outcomes, int max_guesses, bool absurdle) {
+  const std::vector<int> all_answers = all_answer_indices();
+  std::vector<int> answers_left = filter_answers(all_answers, outcomes);
+  printf("Num possible answers: %d\n", answers_left.size());
+  if (answers_left.empty()) {
+    printf("No POSSIBLE ANSWERS\n");
+    return -1;
+  }
+  const std::vector<int> all_guesses = search_guesses();
+  for (int k = 1; k <= max_guesses; k++) {
+    int guess;
+    if (absurdle ? absurdle_within(all_guesses, answers_left, k, &guess)
+	: worst_case_within(all_guesses, answers_left, k, &guess)) {
+      printf("%s  solves within %d\n", GUESSES[guess].c_str(), k);
+      return guess;
+    }
+    printf("Not within %d.\n", k);
+  }
+  return -1;
+}
+
+// Monte Carlo tree search over the same guess/colors tree, as an
+// alternative to best_guess() whose cost is set by a budget rather
+// than a depth. Each node keeps the MCTS_CANDIDATES guesses with the
+// best shallow scores, and a playout descends by picking the guess
+// with the best mean so far plus an exploration bonus weighted by its
+// shallow-score prior, then the colors a random remaining answer gives
+// it, so colors come up as often as their buckets are likely. A new
+// node is valued with the calibrated leaf estimate instead of a random
+// rollout. Values count the guesses to solve, the node's own included.
+//
+// Threads can run playouts on the same tree. Visits and totals are
+// updated atomically, and the statistics a playout reads may be a
+// playout or two behind. A node's edges and an edge's children are
+// computed outside any lock and published under MCTS_MUTEX, so a thread
+// that loses a race to expand a node throws its work away.
+constexpr int MCTS_CANDIDATES = 20;
+constexpr double MCTS_EXPLORATION = 1.0;
+
+std::mutex MCTS_MUTEX;
+
+// Adds value to *total, which other threads may be adding to too.
+void atomic_add(double* total, double value) {
+  double old;
+  __atomic_load(total, &old, __ATOMIC_RELAXED);
+  double sum;
+  do {
+    sum = old + value;
+  } while (!__atomic_compare_exchange(total, &old, &sum, true, __ATOMIC_RELAXED,
+				      __ATOMIC_RELAXED));
+}
+
+struct MctsNode;
+
+struct MctsEdge {
+  int guess;
+  double prior;
+  double estimate;  // Leaf estimate, used as the mean until visited.
+  int visits = 0;
+  double total = 0;
+  // By colors. Guarded by MCTS_MUTEX.
+  std::unordered_map<int, std::unique_ptr<MctsNode>> children;
+
+  double mean() const {
+    const int n = __atomic_load_n(&visits, __ATOMIC_RELAXED);
+    double sum;
+    __atomic_load(&total, &sum, __ATOMIC_RELAXED);
+    return n > 0 ? sum / n : estimate;
+  }
+};
+
+struct MctsNode {
+  std::vector<int> answers;
+  // Set once, before expanded is.
+  std::vector<MctsEdge> edges;
+  bool expanded = false;
+  int visits = 0;
+};
+
+// Picks the node's candidates and returns its estimated value.
+double mcts_expand(MctsNode* node, const std::vector<int>& guesses) {
+  const std::vector<int>& answers = node->answers;
+  const int letters = informative_letters(answers);
+  std::vector<std::pair<int, double>> scores;
+  for (int guess : guesses) {
+    if ((GUESS_LETTER_MASKS[guess] & letters) != 0) {
+      scores.push_back({guess, score_guess(guess, guesses, answers)});
+    }
+  }
+  const int num_candidates = std::min<int>(MCTS_CANDIDATES, scores.size());
+  std::partial_sort(scores.begin(), scores.begin() + num_candidates, scores.end(),
+		    [](auto& left, auto& right) { return left.second < right.second; });
+  scores.resize(num_candidates);
+  for (int i = 0; answers.size() <= 10 && i < answers.size(); i++) {
+    const int guess = ANSWER_GUESSES[answers[i]];
+    if (std::none_of(scores.begin(), scores.end(), [&](auto& s) { return s.first == guess; })) {
+      scores.push_back({guess, score_guess(guess, guesses, answers)});
+    }
+  }
+  const double best_score = scores.empty() ? 0 :
+    std::min_element(scores.begin(), scores.end(), [](auto& left, auto& right) {
+      return left.second < right.second;
+    })->second;
+  double total_prior = 0;
+  double value = INFINITY;
+  std::vector<MctsEdge> edges;
+  for (const auto& score : scores) {
+    MctsEdge edge;
+    edge.guess = score.first;
+    edge.prior = std::exp(best_score - score.second);
+    edge.estimate = 1 + estimate_steps(score.first, answers);
+    total_prior += edge.prior;
+    value = std::min(value, edge.estimate);
+    edges.push_back(std::move(edge));
+  }
+  for (MctsEdge& edge : edges) {
+    edge.prior /= total_prior;
+  }
+  std::lock_guard<std::mutex> lock(MCTS_MUTEX);
+  if (!node->expanded) {
+    node->edges = std::move(edges);
+    __atomic_store_n(&node->expanded, true, __ATOMIC_RELEASE);
+  }
+  return value;
+}
+
+// The node under edge for colors, made on first use.
+MctsNode* mcts_child(MctsNode* node, MctsEdge* edge, int colors) {
+  {
+    std::lock_guard<std::mutex> lock(MCTS_MUTEX);
+    auto found = edge->children.find(colors);
+    if (found != edge->children.end()) {
+      return found->second.get();
+    }
+  }
+  std::unique_ptr<MctsNode> child(new MctsNode);
+  std::vector<int> row(node->answers.size());
+  colors_row(edge->guess, node->answers.data(), node->answers.size(), row.data());
+  for (int i = 0; i < node->answers.size(); i++) {
+    if (row[i] == colors) {
+      child->answers.push_back(node->answers[i]);
+    }
+  }
+  std::lock_guard<std::mutex> lock(MCTS_MUTEX);
+  return edge->children.insert({colors, std::move(child)}).first->second.get();
+}
+
+// One playout from node. Returns the guesses it took.
+double mcts_playout(MctsNode* node, const std::vector<int>& guesses, std::mt19937& rng) {
+  if (node->answers.size() == 1) {
+    return 1;
+  }
+  if (!__atomic_load_n(&node->expanded, __ATOMIC_ACQUIRE)) {
+    __atomic_fetch_add(&node->visits, 1, __ATOMIC_RELAXED);
+    return mcts_expand(node, guesses);
+  }
+  MctsEdge* edge = nullptr;
+  double best = -INFINITY;
+  const int visits = __atomic_load_n(&node->visits, __ATOMIC_RELAXED);
+  for (MctsEdge& e : node->edges) {
+    const double bonus = MCTS_EXPLORATION * e.prior * std::sqrt(visits) /
+      (1 + __atomic_load_n(&e.visits, __ATOMIC_RELAXED));
+    if (-e.mean() + bonus > best) {
+      best = -e.mean() + bonus;
+      edge = &e;
+    }
+  }
+  const int answer = node->answers[rng() % node->answers.size()];
+  const int colors = get_colors(edge->guess, answer);
+  double value = 1;
+  if (colors != 682) {
+    value = 1 + mcts_playout(mcts_child(node, edge, colors), guesses, rng);
+  }
+  __atomic_fetch_add(&edge->visits, 1, __ATOMIC_RELAXED);
+  atomic_add(&edge->total, value);
+  __atomic_fetch_add(&node->visits, 1, __ATOMIC_RELAXED);
+  return value;
+}
+
+// Runs playouts from root until the threads sharing *started have
+// started iterations of them between them, or milliseconds pass, 0
+// being no limit.
+void mcts_run(MctsNode* root, const std::vector<int>& guesses, int iterations,
+	      int milliseconds, unsigned seed, int* started) {
+  std::mt19937 rng(seed);
+  const auto deadline =
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+  while ((iterations == 0 || __atomic_fetch_add(started, 1, __ATOMIC_RELAXED) < iterations) &&
+	 (milliseconds == 0 || std::chrono::steady_clock::now() < deadline)) {
+    mcts_playout(root, guesses, rng);
+  }
+}
+
+// Searches for the best guess after outcomes with MCTS, for the given
+// number of playouts and/or milliseconds; at least one must be set.
+// With NUM_WORKERS, that many threads grow the one tree, each under its
+// own seed and its own Solver on the same dictionary, and share the
+// budget. Returns the most visited guess.
+int solve_mcts(const std::vector<Outcome>& outcomes, int iterations, int milliseconds) {
+  assert(iterations > 0 || milliseconds > 0);
+  const std::vector<int> all_answers = all_answer_indices();
+  MctsNode root;
+  root.answers = filter_answers(all_answers, outcomes);
+  printf("Num possible answers: %d\n", root.answers.size());
+  if (root.answers.empty()) {
+    printf("No POSSIBLE ANSWERS\n");
+    return -1;
+  }
+  if (root.answers.size() == 1) {
+    printf("%s  0\n", ANSWERS[root.answers[0]].c_str());
+    return ANSWER_GUESSES[root.answers[0]];
+  }
+  const std::vector<int> guesses = search_guesses();
+  mcts_expand(&root, guesses);
+  root.visits = 1;
+  int started = 0;
+  if (NUM_WORKERS == 0) {
+    mcts_run(&root, guesses, iterations, milliseconds, 0, &started);
+  } else {
+    std::vector<Solver> solvers;
+    for (int i = 0; i < NUM_WORKERS; i++) {
+      solvers.emplace_back(DICTIONARY);
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < NUM_WORKERS; i++) {
+      threads.emplace_back([&, i]() {
+	enter_numa_node(i);
+	Solver::Scope scope(&solvers[i]);
+	mcts_run(&root, guesses, iterations, milliseconds, i, &started);
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+  const int num_edges = root.edges.size();
+  std::vector<int> visits(num_edges);
+  std::vector<double> totals(num_edges);
+  for (int i = 0; i < num_edges; i++) {
+    visits[i] = root.edges[i].visits;
+    totals[i] = root.edges[i].total;
+  }
+
+  std::vector<int> order(num_edges);
+  for (int i = 0; i < num_edges; i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int left, int right) {
+    return visits[left] > visits[right];
   });
+  for (int i = 0; i < order.size() && i < 5; i++) {
+    const int e = order[i];
+    printf("  %s  %d playouts, %g (prior %.3f)\n", GUESSES[root.edges[e].guess].c_str(),
+	   visits[e], visits[e] > 0 ? totals[e] / visits[e] - 1 : NAN, root.edges[e].prior);
+  }
+  const int best = order[0];
+  // Like best_guess(), the score counts the guesses after this one.
+  printf("%s  %g\n", GUESSES[root.edges[best].guess].c_str(),
+	 visits[best] > 0 ? totals[best] / visits[best] - 1 : root.edges[best].estimate - 1);
+  return root.edges[best].guess;
+}
 
-  if (depth == max_depth) {
-    return shallow_scores[0];
+// A distinct outcome history in batch_solve()'s input.
+struct HistoryNode {
+  std::vector<int> answers;
+  std::map<Outcome, int> children;
+  int guess = -1;  // Result, once searched. -1 if nothing fits.
+  double score = 0;
+  bool done = false;
+  bool failed = false;  // Its workers kept dying.
+};
+
+struct HistoryResult {
+  int guess;
+  double score;
+};
+
+// Says what solve() would play after each history in path, one per
+// line as guess:colors pairs, e.g. "reast:---+- plink:-----". Logs of
+// real games share long prefixes, so the histories go in a trie and
+// each distinct one is searched once, starting from its parent's
+// answers instead of filtering all of them again. The searches are
+// sharded across NUM_WORKERS processes. Each result is printed after
+// its line as soon as every line before it is done, so output stays in
+// input order.
+void batch_solve(const std::string& path, int max_depth);
+
+// batch_solve() with each history's answers searched by search, and
+// the results written to out.
+void solve_histories(const std::string& path, FILE* out,
+		     const std::function<HistoryResult(const std::vector<int>&)>& search) {
+  std::ifstream in(path);
+  if (!in) {
+    perror(path.c_str());
+    exit(1);
+  }
+  std::vector<HistoryNode> nodes(1);
+  nodes[0].answers = all_answer_indices();
+  std::vector<std::string> lines;
+  std::vector<int> line_nodes;  // -1 for lines that don't parse.
+  std::vector<int> pending;  // Nodes to search, in order of first use.
+  std::vector<int> first_lines(1, -1);  // First line ending at each node.
+  std::string line;
+  while (std::getline(in, line)) {
+    lines.push_back(line);
+    int node = 0;
+    for (char* token = strtok(&line[0], " \t"); token != nullptr && node >= 0;
+	 token = strtok(nullptr, " \t")) {
+      char* colors = strchr(token, ':');
+      if (colors == nullptr || strlen(colors + 1) != WORD_LENGTH ||
+	  strspn(colors + 1, "-+!") != WORD_LENGTH) {
+	node = -1;
+	break;
+      }
+      *colors++ = '\0';
+      const int guess = find_guess(token);
+      if (guess < 0) {
+	node = -1;
+	break;
+      }
+      const Outcome outcome = {guess, get_colors_index(colors)};
+      auto child = nodes[node].children.find(outcome);
+      if (child != nodes[node].children.end()) {
+	node = child->second;
+	continue;
+      }
+      HistoryNode next;
+      next.answers = filter_answers(nodes[node].answers, {outcome});
+      nodes[node].children[outcome] = nodes.size();
+      node = nodes.size();
+      nodes.push_back(std::move(next));
+      first_lines.push_back(-1);
+    }
+    line_nodes.push_back(node);
+    if (node >= 0 && first_lines[node] < 0) {
+      first_lines[node] = lines.size() - 1;
+      if (nodes[node].answers.empty()) {
+	nodes[node].done = true;
+      } else {
+	pending.push_back(node);
+      }
+    }
   }
+  fprintf(stderr, "%d histories, %d distinct to search.\n", lines.size(), pending.size());
 
-  int best_guess;
-  double best_score = 1000000;
-  auto iter = shallow_scores.begin();
-  for (int i = 0;
-       iter != shallow_scores.end() && i < MAX_CANDIDATES;
-       ++i) {
+  // Prints the lines whose results are in, up to the first that isn't.
+  int next_line = 0;
+  auto flush = [&]() {
+    for (; next_line < lines.size(); next_line++) {
+      const int n = line_nodes[next_line];
+      if (n >= 0 && !nodes[n].done) {
+	break;
+      }
+      if (n < 0) {
+	fprintf(out, "%s\tbad history\n", lines[next_line].c_str());
+      } else if (nodes[n].failed) {
+	fprintf(out, "%s\tsearch failed\n", lines[next_line].c_str());
+      } else if (nodes[n].guess < 0) {
+	fprintf(out, "%s\tno answers\n", lines[next_line].c_str());
+      } else {
+	fprintf(out, "%s\t%s %g\n", lines[next_line].c_str(),
+		GUESSES[nodes[n].guess].c_str(), nodes[n].score);
+      }
+    }
+    fflush(out);
+  };
+
+  const bool verbose = VERBOSE;
+  VERBOSE = false;
+  flush();
+  const std::vector<int> failed = run_sharded<HistoryResult>(pending, [&](int node) {
+    return search(nodes[node].answers);
+  }, [&](int node, const HistoryResult& result) {
+    nodes[node].guess = result.guess;
+    nodes[node].score = result.score;
+    nodes[node].done = true;
+    flush();
+  }, [&](int node) {
+    return "line " + std::to_string(first_lines[node] + 1) + "'s history";
+  });
+  for (int node : failed) {
+    nodes[node].failed = true;
+    nodes[node].done = true;
+  }
+  flush();
+  VERBOSE = verbose;
+}
+
+void batch_solve(const std::string& path, int max_depth) {
+  const std::vector<int> guesses = search_guesses();
+  solve_histories(path, stdout, [&](const std::vector<int>& answers) {
+    auto result = best_guess(guesses, answers, 0, max_depth);
+    return HistoryResult{result.first, result.second};
+  });
+}
+
+// Relabels the colors guess gets against each of answers in order of
+// first appearance, so guesses that split answers into the same
+// buckets get the same signature. "!!!!!" keeps its own label since
+// that bucket is already solved.
+std::vector<int> split_signature(int guess, const std::vector<int>& answers) {
+  std::vector<int> colors(answers.size());
+  colors_row(guess, answers.data(), answers.size(), colors.data());
+  std::unordered_map<int, int> labels = {{682, 0}};
+  std::vector<int> signature;
+  for (int c : colors) {
+    auto inserted = labels.insert({c, labels.size()});
+    signature.push_back(inserted.first->second);
+  }
+  return signature;
+}
+
+// The best guess for answers over all of guesses and its expected
+// number of further guesses, searched exhaustively. Guesses that split
+// answers the same way are only tried once, and in order of a lower
+// bound on their score, which also cuts off the ones that can't win:
+// a bucket of b answers needs at least (b - 1) / b guesses after the
+// one that leads to it, when its first guess is right 1 time in b and
+// the next one always is. Meant for the small sets TABLEBASE holds;
+// memo keeps the sets already solved.
+std::pair<int, double> solve_exact(
+    const std::vector<int>& guesses, const std::vector<int>& answers,
+    std::unordered_map<std::string, std::pair<int, double>>* memo) {
+  if (answers.size() == 1) {
+    return {ANSWER_GUESSES[answers[0]], 0.0};
+  }
+  const std::string key = subset_key(answers);
+  auto found = memo->find(key);
+  if (found != memo->end()) {
+    return found->second;
+  }
+  const double n = answers.size();
+  // Lower bound on the guesses a bucket of size answers costs,
+  // counting the one that led to it.
+  auto bucket_bound = [](int size) { return 1.0 + (size - 1.0) / size; };
+
+  struct Split {
     int guess;
-    if (answers.size() <= 10 && i < answers.size()) {
-      // If there's only a few answers left, always try to guess them
-      // first.
-      guess = lookup_guess(ANSWERS[answers[i]]);
-    } else {
-      guess = iter->first;
-      ++iter;
+    double bound;
+    std::vector<std::pair<int, std::vector<int>>> buckets;
+  };
+  std::vector<Split> splits;
+  std::unordered_set<std::string> seen;
+  // Answers first, so they win ties.
+  std::vector<int> order;
+  for (int answer : answers) {
+    order.push_back(ANSWER_GUESSES[answer]);
+  }
+  order.insert(order.end(), guesses.begin(), guesses.end());
+  for (int guess : order) {
+    const std::vector<int> signature = split_signature(guess, answers);
+    if (!seen.insert(subset_key(signature)).second) {
+      continue;
     }
-    double score = score_guess_steps(guess, worthwhile_guesses, answers, depth, max_depth);
-    if (depth == 0) {
-      printf("Candidate %03d/%03d: %s  %g\n", i, MAX_CANDIDATES, GUESSES[guess].c_str(), score);
+    Split split = {guess, 0.0, split_answers(guess, answers)};
+    if (split.buckets.size() == 1 && split.buckets[0].first != 682) {
+      continue;  // Learns nothing.
     }
-    if (score < best_score) {
-      best_guess = guess;
-      best_score = score;
-      if (depth == 0) {
-	printf("  New best: %s - %g\n", GUESSES[best_guess].c_str(), best_score);
+    for (const auto& bucket : split.buckets) {
+      if (bucket.first != 682) {
+	split.bound += bucket.second.size() * bucket_bound(bucket.second.size()) / n;
+      }
+    }
+    splits.push_back(std::move(split));
+  }
+  std::stable_sort(splits.begin(), splits.end(), [](const Split& left, const Split& right) {
+    return left.bound < right.bound;
+  });
+
+  std::pair<int, double> best = {-1, INFINITY};
+  for (const Split& split : splits) {
+    if (split.bound >= best.second) {
+      break;
+    }
+    double score = split.bound;
+    for (const auto& bucket : split.buckets) {
+      if (bucket.first == 682 || bucket.second.size() == 1 || score >= best.second) {
+	continue;
       }
+      const double size = bucket.second.size();
+      score += size / n * (1 + solve_exact(guesses, bucket.second, memo).second -
+			   bucket_bound(size));
+    }
+    if (score < best.second) {
+      best = {split.guess, score};
     }
   }
-  return {best_guess, best_score};
+  (*memo)[key] = best;
+  return best;
 }
 
-int solve(const std::vector<Outcome>& outcomes, int max_depth) {
-  std::vector<int> all_answers;
-  for (int i = 0; i < ANSWERS.size(); i++) {
-    all_answers.push_back(i);
+// Whether knowing guess a's colors against an answer always tells you
+// b's, i.e. a's partition of the answers refines b's.
+bool refines(const uint16_t* a, const uint16_t* b, int num_answers) {
+  int16_t b_of_a[683];
+  std::fill(b_of_a, b_of_a + 683, -1);
+  for (int i = 0; i < num_answers; i++) {
+    if (b_of_a[a[i]] < 0) {
+      b_of_a[a[i]] = b[i];
+    } else if (b_of_a[a[i]] != b[i]) {
+      return false;
+    }
   }
-  std::vector<int> answers_left = filter_answers(all_answers, outcomes);
-  printf("Num possible answers: %d\n", answers_left.size());
+  return true;
+}
+
+// The C interface's tables, defined with it below.
+extern std::shared_ptr<Dictionary> API_DICTIONARY;
+
+void test() {
+  // Words are found by binary search of the compiled-in alphabetical
+  // order, from either end, and nothing else is.
+  assert(find_guess(GUESSES[0].c_str()) == 0);
+  assert(find_guess(GUESSES[GUESSES.size() - 1].c_str()) == GUESSES.size() - 1);
+  assert(GUESSES[find_guess("reast")] == "reast" && ANSWERS[find_answer("thorn")] == "thorn");
+  assert(find_guess("aaaaa") < 0 && find_guess("zzzzz") < 0 && find_answer("aahed") < 0);
+
+  std::vector<Outcome> outcomes = {
+    make_outcome("crane", "--+-!"),
+    make_outcome("mauls", "-!!-+")
+  };
+  assert(possible_answer(lookup_answer("pause"), outcomes));
+  assert(!possible_answer(lookup_answer("acorn"), outcomes));
   
-  if (answers_left.empty()) {
-    printf("No POSSIBLE ANSWERS\n");
-    return 0;
+  std::vector<Outcome> outcomes2 = {
+    make_outcome("taboo", "-!-!-"),
+  };
+  assert(!possible_answer(lookup_answer("taboo"), outcomes2));
+  assert(possible_answer(lookup_answer("wagon"), outcomes2));
+
+  assert(get_colors(lookup_guess("abbey"), lookup_answer("abbey")) == get_colors_index("!!!!!"));
+  assert(get_colors(lookup_guess("reast"), lookup_answer("thorn")) == get_colors_index("+---+"));
+  assert(get_colors(lookup_guess("throb"), lookup_answer("thorn")) == get_colors_index("!!++-"));
+  assert(get_colors(lookup_guess("orate"), lookup_answer("thorn")) == get_colors_index("++-+-"));
+  assert(get_colors(lookup_guess("roast"), lookup_answer("thorn")) == get_colors_index("++--+"));
+  assert(get_colors(lookup_guess("court"), lookup_answer("thorn")) == get_colors_index("-+-!+"));
+  assert(get_colors(lookup_guess("thorn"), lookup_answer("thorn")) == get_colors_index("!!!!!"));
+  assert(get_colors(lookup_guess("reast"), lookup_answer("other")) == get_colors_index("++--+"));
+  assert(get_colors(lookup_guess("tutee"), lookup_answer("other")) == get_colors_index("+--!-"));
+  assert(get_colors(lookup_guess("other"), lookup_answer("other")) == get_colors_index("!!!!!"));
+  assert(get_colors(lookup_guess("reast"), lookup_answer("tacit")) == get_colors_index("--+-!"));
+  assert(get_colors(lookup_guess("dough"), lookup_answer("tacit")) == get_colors_index("-----"));
+  assert(get_colors(lookup_guess("tapis"), lookup_answer("tacit")) == get_colors_index("!!-!-"));
+  assert(get_colors(lookup_guess("quail"), lookup_answer("tacit")) == get_colors_index("--+!-"));
+  assert(get_colors(lookup_guess("peony"), lookup_answer("tacit")) == get_colors_index("-----"));
+  assert(get_colors(lookup_guess("magic"), lookup_answer("tacit")) == get_colors_index("-!-!+"));
+  assert(get_colors(lookup_guess("tacit"), lookup_answer("tacit")) == get_colors_index("!!!!!"));
+
+  const int letters = informative_letters({lookup_answer("thorn"), lookup_answer("shorn")});
+  assert(letters == get_letter_mask("st"));
+  assert((GUESS_LETTER_MASKS[lookup_guess("abbey")] & letters) == 0);
+  assert((GUESS_LETTER_MASKS[lookup_guess("tacit")] & letters) != 0);
+
+  int guess;
+  const std::vector<int> thorn_shorn = {lookup_answer("thorn"), lookup_answer("shorn")};
+  assert(!worst_case_within({lookup_guess("thorn")}, thorn_shorn, 1, &guess));
+  assert(worst_case_within({lookup_guess("thorn")}, thorn_shorn, 2, &guess));
+  assert(guess == lookup_guess("thorn"));
+  assert(absurdle_within({lookup_guess("thorn")}, thorn_shorn, 2, &guess));
+  // A bound found with thorn says nothing about a pool without it.
+  assert(!worst_case_within({lookup_guess("abbey")}, thorn_shorn, 2, &guess));
+
+  // Either of two answers takes one or two guesses, 1.5 on average.
+  {
+    MctsNode node;
+    node.answers = thorn_shorn;
+    std::mt19937 rng(0);
+    for (int i = 0; i < 200; i++) {
+      mcts_playout(&node, {lookup_guess("thorn"), lookup_guess("shorn")}, rng);
+    }
+    for (const MctsEdge& edge : node.edges) {
+      assert(edge.visits > 0 && std::abs(edge.mean() - 1.5) < 0.2);
+    }
+
+    // The same with two threads sharing the tree and the budget.
+    MctsNode shared;
+    shared.answers = thorn_shorn;
+    int started = 0;
+    std::vector<Solver> solvers;
+    for (int i = 0; i < 2; i++) {
+      solvers.emplace_back(DICTIONARY);
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 2; i++) {
+      threads.emplace_back([&, i]() {
+	Solver::Scope scope(&solvers[i]);
+	mcts_run(&shared, {lookup_guess("thorn"), lookup_guess("shorn")}, 200, 0, i, &started);
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    assert(shared.visits == 200);
+    for (const MctsEdge& edge : shared.edges) {
+      assert(edge.visits > 0 && std::abs(edge.mean() - 1.5) < 0.2);
+    }
   }
 
-  if (answers_left.size() <= 5) {
-    printf("POSSIBLE ANSWERS:");
-    for (int answer : answers_left) {
-      printf(" '%s'", ANSWERS[answer].c_str());
+  // The matrix-free kernel agrees with the cache.
+  const std::vector<int> all_answers = all_answer_indices();
+  std::vector<int> computed(ANSWERS.size());
+  for (int guess = 0; guess < GUESSES.size(); guess += 37) {
+    compute_colors_row(guess, all_answers.data(), all_answers.size(), computed.data());
+    for (int answer = 0; answer < ANSWERS.size(); answer++) {
+      assert(computed[answer] == get_colors(guess, answer));
     }
-    printf("\n");
   }
 
-  std::vector<int> all_guesses;
-  for (int i = 0; i < GUESSES.size(); i++) {
-    all_guesses.push_back(i);
+  // So does the tile store, both when it fills tiles and when it reads
+  // them back from the file, with one tile mapped at a time.
+  char tile_path[] = "/tmp/wordle4_tilesXXXXXX";
+  close(mkstemp(tile_path));
+  for (int pass = 0; pass < 2; pass++) {
+    TileStore store(tile_path, 1);
+    for (int guess = 0; guess < GUESSES.size(); guess += 37) {
+      store.row(guess, all_answers.data(), all_answers.size(), computed.data());
+      for (int answer = 0; answer < ANSWERS.size(); answer++) {
+	assert(computed[answer] == get_colors(guess, answer));
+      }
+    }
+    assert(store.tiles_computed() == (pass == 0 ? store.tiles_mapped() : 0));
+  }
+  unlink(tile_path);
+
+  // Exact endgame values: guessing one of two answers first takes half
+  // a guess more on average, and no search does better than exact.
+  {
+    std::unordered_map<std::string, std::pair<int, double>> memo;
+    assert(solve_exact(search_guesses(), thorn_shorn, &memo).second == 0.5);
+    const std::vector<int> endgame = filter_answers(
+      all_answers, {make_outcome("reast", "---+-"), make_outcome("plink", "-----")});
+    const bool verbose = VERBOSE;
+    VERBOSE = false;
+    assert(solve_exact(search_guesses(), endgame, &memo).second <=
+	   best_guess(search_guesses(), endgame, 0, 2).second + 1e-9);
+    VERBOSE = verbose;
+    std::vector<int> reversed(endgame.rbegin(), endgame.rend());
+    assert(tablebase_words(reversed) == tablebase_words(endgame));
+
+    // A tablebase entry is only used for the answers it was built for,
+    // even when another set's key collides with it.
+    TABLEBASE.insert({tablebase_key(tablebase_words(endgame)),
+		      {tablebase_words(thorn_shorn), ANSWERS[thorn_shorn[0]], 0.5}});
+    TABLEBASE.insert({tablebase_key(tablebase_words(thorn_shorn)),
+		      {tablebase_words(thorn_shorn), ANSWERS[thorn_shorn[0]], 0.5}});
+    std::pair<int, double> solved;
+    assert(!lookup_tablebase(endgame, &solved));
+    assert(lookup_tablebase(thorn_shorn, &solved) && solved.second == 0.5);
+    TABLEBASE.clear();
+  }
+
+  // Successive halving only samples its way to the candidates; they're
+  // still scored exactly, so the search picks what the full pass does.
+  // The answers alone make a dictionary small enough to search quickly,
+  // and are enough of them for a round of sampling.
+  {
+    const std::vector<int> subset(all_answers.begin(),
+				  all_answers.begin() + 4 * HALVING_INITIAL_SAMPLE);
+    std::vector<int> guesses;
+    for (int answer : subset) {
+      guesses.push_back(ANSWER_GUESSES[answer]);
+    }
+    const bool verbose = VERBOSE;
+    VERBOSE = false;
+    const std::pair<int, double> expected = best_guess(guesses, subset, 0, 1);
+    SUCCESSIVE_HALVING = true;
+    assert(best_guess(guesses, subset, 0, 1) == expected);
+    SUCCESSIVE_HALVING = false;
+    VERBOSE = verbose;
+  }
+
+  // A traced search leaves one line per stack: the root, each candidate
+  // under it, and each bucket the candidate leaves under that, with
+  // their sizes adding up to the answers that aren't the candidate.
+  {
+    const std::vector<int> subset = filter_answers(all_answers, {make_outcome("reast", "---+-")});
+    const std::string root = "root[" + std::to_string(subset.size()) + "]";
+    char trace_path[] = "/tmp/wordle4_traceXXXXXX";
+    close(mkstemp(trace_path));
+    const bool verbose = VERBOSE;
+    VERBOSE = false;
+    Tracer tracer;
+    TRACER = &tracer;
+    TRACER->push(root);
+    const int best = best_guess(search_guesses(), subset, 0, 1).first;
+    TRACER->pop();
+    TRACER = nullptr;
+    VERBOSE = verbose;
+    tracer.write(trace_path);
+    std::ifstream in(trace_path);
+    std::string stack;
+    long long micros;
+    int num_lines = 0;
+    int best_bucket_answers = 0;
+    const std::string best_frame = root + ";" + GUESSES[best].c_str();
+    while (in >> stack >> micros) {
+      num_lines++;
+      assert(micros >= 0);
+      assert(stack.compare(0, root.size(), root) == 0);
+      assert(std::count(stack.begin(), stack.end(), ';') <= 2);
+      if (stack.compare(0, best_frame.size() + 1, best_frame + ";") == 0) {
+	const size_t open = stack.find('[', best_frame.size());
+	best_bucket_answers += atoi(stack.c_str() + open + 1);
+      }
+    }
+    assert(num_lines > 1);
+    const bool best_is_answer = std::count(subset.begin(), subset.end(),
+					   find_answer(GUESSES[best].c_str())) > 0;
+    assert(best_bucket_answers == subset.size() - best_is_answer);
+    unlink(trace_path);
+  }
+
+  // A speculated search finds what the same search run on the spot
+  // does. The speculation starts on the largest bucket, so given a
+  // moment it's either finished or partway through the one asked for,
+  // which lookup() then waits for.
+  {
+    const std::vector<int> subset = filter_answers(all_answers, {make_outcome("reast", "---+-")});
+    const int guess = lookup_guess("cloud");
+    const std::vector<int> bucket = split_answers(guess, subset)[0].second;
+    const bool verbose = VERBOSE;
+    VERBOSE = false;
+    const std::pair<int, double> expected = best_guess(search_guesses(), bucket, 0, 1);
+    Speculator speculator;
+    speculator.start(guess, subset, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    std::pair<int, double> result;
+    assert(speculator.lookup(bucket, 1, &result));
+    assert(result == expected);
+    // Searches for another depth aren't reused.
+    assert(!speculator.lookup(bucket, 2, &result));
+    VERBOSE = verbose;
+  }
+
+  // A search killed partway through resumes from its checkpoint,
+  // skipping the candidates it finished, and ends up where an
+  // uninterrupted search does. A checkpoint for other inputs is ignored.
+  {
+    const std::vector<int> subset = filter_answers(all_answers, {make_outcome("reast", "---+-")});
+    char checkpoint_path[] = "/tmp/wordle4_checkpointXXXXXX";
+    close(mkstemp(checkpoint_path));
+    const bool verbose = VERBOSE;
+    VERBOSE = false;
+    const std::pair<int, double> expected = best_guess(search_guesses(), subset, 0, 1);
+    int num_candidates;
+    {
+      Checkpoint checkpoint(checkpoint_path, "test");
+      assert(best_guess(search_guesses(), subset, 0, 1, &checkpoint) == expected);
+      num_candidates = checkpoint.completed().size();
+    }
+    // Keep the key and two candidates, and cut the next line short like
+    // a kill would.
+    std::vector<std::string> lines;
+    {
+      std::ifstream in(checkpoint_path);
+      std::string line;
+      while (std::getline(in, line)) {
+	if (line.compare(0, 4, "best") != 0) {
+	  lines.push_back(line);
+	}
+      }
+    }
+    assert(lines.size() == num_candidates + 1 && num_candidates > 3);
+    FILE* f = fopen(checkpoint_path, "w");
+    fprintf(f, "%s\n%s\n%s\n%s", lines[0].c_str(), lines[1].c_str(), lines[2].c_str(),
+	    lines[3].substr(0, 12).c_str());
+    fclose(f);
+    {
+      Checkpoint checkpoint(checkpoint_path, "test");
+      assert(checkpoint.completed().size() == 2);
+      assert(best_guess(search_guesses(), subset, 0, 1, &checkpoint) == expected);
+      assert(checkpoint.completed().size() == num_candidates);
+    }
+    {
+      Checkpoint checkpoint(checkpoint_path, "other");
+      assert(checkpoint.completed().empty());
+    }
+    VERBOSE = verbose;
+    unlink(checkpoint_path);
+  }
+
+  // Openers that leave the same bucket share its search through
+  // SUBTREE_MEMO, which doesn't change their scores.
+  {
+    std::vector<double> expected;
+    for (const char* opener : {"reast", "stare"}) {
+      expected.push_back(score_guess_steps(lookup_guess(opener), search_guesses(), all_answers,
+					   0, 1));
+    }
+    std::unordered_map<std::string, std::pair<int, double>> memo;
+    SUBTREE_MEMO = &memo;
+    assert(score_guess_steps(lookup_guess("reast"), search_guesses(), all_answers, 0, 1) ==
+	   expected[0]);
+    const int reast_buckets = memo.size();
+    assert(score_guess_steps(lookup_guess("stare"), search_guesses(), all_answers, 0, 1) ==
+	   expected[1]);
+    SUBTREE_MEMO = nullptr;
+    assert(memo.size() < 2 * reast_buckets);
+  }
+
+  // A dead worker's task goes to a new worker, and a task that keeps
+  // killing its workers is given up on rather than run here.
+  {
+    int* deaths = static_cast<int*>(mmap(nullptr, sizeof(int), PROT_READ | PROT_WRITE,
+					 MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    *deaths = 0;
+    const int num_workers = NUM_WORKERS;
+    NUM_WORKERS = 2;
+    std::map<int, int> results;
+    const std::vector<int> failed = run_sharded<int>({0, 1, 2, 3}, [&](int task) {
+      if (task == 2 || (task == 1 && __sync_fetch_and_add(deaths, 1) == 0)) {
+	_exit(1);
+      }
+      return task * 10;
+    }, [&](int task, const int& result) {
+      results[task] = result;
+    }, [](int task) {
+      return "task " + std::to_string(task);
+    });
+    NUM_WORKERS = num_workers;
+    assert(failed == std::vector<int>({2}));
+    assert(results == (std::map<int, int>{{0, 0}, {1, 10}, {3, 30}}));
+    assert(*deaths == 2);
+    munmap(deaths, sizeof(int));
+  }
+
+  // So does a batch history's, and its line still gets its result, in
+  // order.
+  {
+    int* deaths = static_cast<int*>(mmap(nullptr, sizeof(int), PROT_READ | PROT_WRITE,
+					 MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    *deaths = 0;
+    const std::vector<std::string> histories = {
+      "reast:---+-", "reast:---+- plink:-----", "reast:-+---"};
+    char histories_path[] = "/tmp/wordle4_historiesXXXXXX";
+    const int fd = mkstemp(histories_path);
+    std::vector<std::string> expected;
+    std::string contents;
+    for (const std::string& history : histories) {
+      contents += history + "\n";
+      std::vector<Outcome> outcomes;
+      std::istringstream words(history);
+      std::string word;
+      while (words >> word) {
+	outcomes.push_back(make_outcome(word.substr(0, WORD_LENGTH),
+					word.substr(WORD_LENGTH + 1)));
+      }
+      const std::vector<int> answers = filter_answers(all_answers, outcomes);
+      expected.push_back(history + "\t" + ANSWERS[answers[0]].c_str() + " " +
+			 std::to_string(answers.size()));
+    }
+    assert(write(fd, contents.data(), contents.size()) == contents.size());
+    close(fd);
+    char results_path[] = "/tmp/wordle4_resultsXXXXXX";
+    close(mkstemp(results_path));
+    FILE* out = fopen(results_path, "w");
+    const int dying_size = filter_answers(
+      all_answers, {make_outcome("reast", "---+-"), make_outcome("plink", "-----")}).size();
+    const int num_workers = NUM_WORKERS;
+    NUM_WORKERS = 2;
+    solve_histories(histories_path, out, [&](const std::vector<int>& answers) {
+      if (answers.size() == dying_size && __sync_fetch_and_add(deaths, 1) == 0) {
+	_exit(1);
+      }
+      return HistoryResult{ANSWER_GUESSES[answers[0]], static_cast<double>(answers.size())};
+    });
+    NUM_WORKERS = num_workers;
+    fclose(out);
+    std::ifstream in(results_path);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+      lines.push_back(line);
+    }
+    assert(lines == expected);
+    assert(*deaths == 2);
+    munmap(deaths, sizeof(int));
+    unlink(histories_path);
+    unlink(results_path);
+  }
+
+  // Rows read back from a submatrix, for a subset of its answers, match
+  // the full matrix, as do rows of guesses it doesn't have.
+  {
+    const std::vector<int> subset = filter_answers(all_answers, outcomes2);
+    const std::vector<int> part = {subset[1], subset.back()};
+    SubMatrix submatrix({lookup_guess("reast"), lookup_guess("wagon")}, subset);
+    for (const char* guess : {"wagon", "tacit"}) {
+      int colors[2];
+      colors_row(lookup_guess(guess), part.data(), part.size(), colors);
+      assert(colors[0] == get_colors(lookup_guess(guess), part[0]));
+      assert(colors[1] == get_colors(lookup_guess(guess), part[1]));
+    }
+  }
+  assert(SUBMATRIX == nullptr);
+
+  // A partition refines itself and anything coarser, but not the
+  // other way round.
+  {
+    std::vector<uint16_t> fine(ANSWERS.size()), coarse(ANSWERS.size());
+    for (int answer = 0; answer < ANSWERS.size(); answer++) {
+      fine[answer] = get_colors(lookup_guess("reast"), answer);
+      coarse[answer] = fine[answer] == get_colors_index("-----");
+    }
+    assert(refines(fine.data(), fine.data(), ANSWERS.size()));
+    assert(refines(fine.data(), coarse.data(), ANSWERS.size()));
+    assert(!refines(coarse.data(), fine.data(), ANSWERS.size()));
+  }
+
+  // Batched scores match scoring each subset on its own.
+  const std::vector<std::vector<int>> subsets = {
+    filter_answers(all_answers, outcomes), filter_answers(all_answers, outcomes2),
+    {lookup_answer("thorn")}, {}, all_answers};
+  const std::vector<int> batch_guesses = {
+    lookup_guess("reast"), lookup_guess("crane"), lookup_guess("tacit"), lookup_guess("zymic")};
+  const auto batch_scores = score_guesses_batch(batch_guesses, subsets);
+  for (int s = 0; s < subsets.size(); s++) {
+    for (int g = 0; g < batch_guesses.size(); g++) {
+      const double expected =
+	subsets[s].empty() ? 0.0 : score_guess(batch_guesses[g], {}, subsets[s]);
+      assert(std::abs(batch_scores[s][g] - expected) < 1e-9);
+    }
+  }
+
+  // Narrowed scores match scoring what's left from scratch, whether a
+  // few answers are counted out or most are and the rest counted in.
+  {
+    ShallowScores scores(batch_guesses, all_answers);
+    std::vector<int> answers = all_answers;
+    answers.erase(answers.begin() + 100, answers.begin() + 110);
+    for (const std::vector<int>& left : {answers, subsets[0]}) {
+      assert(scores.covers(left));
+      scores.narrow(left);
+      for (int guess : batch_guesses) {
+	assert(std::abs(scores.score(guess) - score_guess(guess, {}, left)) < 1e-9);
+      }
+    }
+    assert(!scores.covers(subsets[1]));
+    assert(scores.score(lookup_guess("thorn")) < 0);
+  }
+
+  // Solvers on different threads share the dictionary but nothing
+  // else, and search as they would alone.
+  {
+    const std::vector<std::vector<int>> subsets = {
+      filter_answers(all_answers, outcomes), filter_answers(all_answers, outcomes2),
+      filter_answers(all_answers,
+		     {make_outcome("reast", "---+-"), make_outcome("plink", "---+-")})};
+    const bool verbose = VERBOSE;
+    VERBOSE = false;
+    std::vector<std::pair<int, double>> expected, results(subsets.size());
+    for (const std::vector<int>& subset : subsets) {
+      expected.push_back(best_guess(search_guesses(), subset, 0, 1));
+    }
+    std::vector<Solver> solvers;
+    for (int i = 0; i < subsets.size(); i++) {
+      solvers.emplace_back(DICTIONARY);
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < subsets.size(); i++) {
+      threads.emplace_back([&, i]() {
+	Solver::Scope scope(&solvers[i]);
+	results[i] = best_guess(search_guesses(), subsets[i], 0, 1);
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    VERBOSE = verbose;
+    assert(results == expected);
+    assert(solvers[0].cache_hits() > 0);
+
+    // So do resumable searches stepped a few nodes at a time, alone or
+    // taking turns on a scheduler's threads, and cancelling one doesn't
+    // disturb the rest.
+    ResumableSearch search(search_guesses(), subsets[2], 1);
+    int slices = 1;
+    while (!search.step(1000)) {
+      slices++;
+    }
+    assert(slices > 1 && search.result() == expected[2]);
+    SearchScheduler scheduler(2, 1000);
+    std::vector<int> ids;
+    for (const std::vector<int>& subset : subsets) {
+      ids.push_back(scheduler.submit(DICTIONARY, GUESS_POOL, subset, 1));
+    }
+    const int cancelled = scheduler.submit(DICTIONARY, GUESS_POOL, all_answers, 2);
+    scheduler.cancel(cancelled);
+    for (int i = 0; i < ids.size(); i++) {
+      std::pair<int, double> result;
+      assert(scheduler.wait(ids[i], &result) && result == expected[i]);
+    }
+    std::pair<int, double> unused;
+    assert(!scheduler.wait(cancelled, &unused));
+    // Waiting forgets a search, and ids the scheduler never gave out
+    // are neither waited on nor cancelled.
+    assert(scheduler.num_sessions() == 0);
+    assert(!scheduler.wait(ids[0], &unused));
+    scheduler.cancel(-1);
+    scheduler.close(ids.size() + 1);
+    assert(!scheduler.wait(ids.size() + 5, &unused));
+
+    // Two sessions taking turns on one thread get what searching each
+    // on its own does, and a closed one is forgotten without a wait.
+    SearchScheduler one_thread(1, 1000);
+    const int first = one_thread.submit(DICTIONARY, GUESS_POOL, subsets[0], 1);
+    const int closed = one_thread.submit(DICTIONARY, GUESS_POOL, all_answers, 2);
+    const int second = one_thread.submit(DICTIONARY, GUESS_POOL, subsets[1], 1);
+    one_thread.close(closed);
+    std::pair<int, double> result;
+    assert(one_thread.wait(second, &result) && result == expected[1]);
+    assert(one_thread.wait(first, &result) && result == expected[0]);
+    assert(one_thread.num_sessions() == 0);
+  }
+
+  // A thread on a NUMA node reads that node's copy of the colors.
+  {
+    assert(parse_cpu_list("0-2,5") == std::vector<int>({0, 1, 2, 5}));
+    assert(parse_cpu_list("7") == std::vector<int>({7}));
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+	cpus.push_back(cpu);
+      }
+    }
+    const int reast_thorn = get_colors(lookup_guess("reast"), lookup_answer("thorn"));
+    NUMA_NODES = {cpus};
+    replicate_colors_cache(DICTIONARY.get(), NUMA_NODES);
+    // Entries filled in after the copy reach it on a refresh.
+    const int entry = lookup_guess("reast") * ANSWERS.size() + lookup_answer("thorn");
+    DICTIONARY->colors_replicas[0].get()[entry] = -1;
+    refresh_colors_replicas(DICTIONARY.get());
+    assert(DICTIONARY->colors_replicas[0].get()[entry] == reast_thorn);
+    enter_numa_node(0);
+    assert(COLORS_CACHE == DICTIONARY->colors_replicas[0].get());
+    assert(get_colors(lookup_guess("reast"), lookup_answer("thorn")) == reast_thorn);
+    NUMA_NODES.clear();
+    NUMA_NODE = -1;
+    DICTIONARY->colors_replicas.clear();
+    bind_dictionary(DICTIONARY);
   }
-  auto result = best_guess(all_guesses, answers_left, 0, max_depth);
-  printf("%s  %g\n", GUESSES[result.first].c_str(), result.second);
-  return result.first;
-}
 
-void test() {
-  std::vector<Outcome> outcomes = {
-    make_outcome("crane", "--+-!"),
-    make_outcome("mauls", "-!!-+")
-  };
-  assert(possible_answer(lookup_answer("pause"), outcomes));
-  assert(!possible_answer(lookup_answer("acorn"), outcomes));
-  
-  std::vector<Outcome> outcomes2 = {
-    make_outcome("taboo", "-!-!-"),
-  };
-  assert(!possible_answer(lookup_answer("taboo"), outcomes2));
-  assert(possible_answer(lookup_answer("wagon"), outcomes2));
+  // The C interface turns away indices out of range instead of reading
+  // past the tables.
+  {
+    const bool verbose = VERBOSE;
+    API_DICTIONARY = DICTIONARY;
+    const int reast = lookup_guess("reast");
+    const int bad_guess = 99999;
+    const int colors = get_colors_index("---+-");
+    std::vector<int> answers(ANSWERS.size());
+    double score;
+    assert(wordlitzer_filter(&bad_guess, &colors, 1, answers.data()) == -1);
+    assert(wordlitzer_filter(&reast, &colors, 1, answers.data()) > 0);
+    assert(wordlitzer_score_guesses(&bad_guess, 1, answers.data(), 1, &score) == -1);
+    assert(wordlitzer_score_guesses(&reast, 1, &bad_guess, 1, &score) == -1);
+    const int subset_size = 1;
+    assert(wordlitzer_score_guesses_batch(&reast, 1, &bad_guess, &subset_size, 1, &score) ==
+	   -1);
+    assert(wordlitzer_solve(&bad_guess, &colors, 1, 1, &score) == -1);
+    API_DICTIONARY.reset();
+    VERBOSE = verbose;
+  }
 
+  // Updates keep cached colors and only compute the new ones. Run at the
+  // end since they change the tables.
+  const int reast_thorn = get_colors(lookup_guess("reast"), lookup_answer("thorn"));
+  assert(update_dictionary({{"zzzzz"}, {}, {}, {"abbey"}}));
+  assert(lookup_guess("zzzzz") == GUESSES.size() - 1);
+  assert(ANSWERS.size() == 2314);
+  assert(GUESSES[ANSWER_GUESSES[lookup_answer("thorn")]] == "thorn");
+  assert(get_colors(lookup_guess("reast"), lookup_answer("thorn")) == reast_thorn);
+  assert(get_colors(lookup_guess("zzzzz"), lookup_answer("thorn")) == get_colors_index("-----"));
+  assert(!update_dictionary({{}, {"thorn"}, {}, {}}));  // Still an answer.
+  assert(update_dictionary({{}, {"zzzzz"}, {"abbey"}, {}}));
   assert(get_colors(lookup_guess("abbey"), lookup_answer("abbey")) == get_colors_index("!!!!!"));
-  assert(get_colors(lookup_guess("reast"), lookup_answer("thorn")) == get_colors_index("+---+"));
-  assert(get_colors(lookup_guess("throb"), lookup_answer("thorn")) == get_colors_index("!!++-"));
-  assert(get_colors(lookup_guess("orate"), lookup_answer("thorn")) == get_colors_index("++-+-"));
-  assert(get_colors(lookup_guess("roast"), lookup_answer("thorn")) == get_colors_index("++--+"));
-  assert(get_colors(lookup_guess("court"), lookup_answer("thorn")) == get_colors_index("-+-!+"));
-  assert(get_colors(lookup_guess("thorn"), lookup_answer("thorn")) == get_colors_index("!!!!!"));
-  assert(get_colors(lookup_guess("reast"), lookup_answer("other")) == get_colors_index("++--+"));
-  assert(get_colors(lookup_guess("tutee"), lookup_answer("other")) == get_colors_index("+--!-"));
-  assert(get_colors(lookup_guess("other"), lookup_answer("other")) == get_colors_index("!!!!!"));
-  assert(get_colors(lookup_guess("reast"), lookup_answer("tacit")) == get_colors_index("--+-!"));
-  assert(get_colors(lookup_guess("dough"), lookup_answer("tacit")) == get_colors_index("-----"));
-  assert(get_colors(lookup_guess("tapis"), lookup_answer("tacit")) == get_colors_index("!!-!-"));
-  assert(get_colors(lookup_guess("quail"), lookup_answer("tacit")) == get_colors_index("--+!-"));
-  assert(get_colors(lookup_guess("peony"), lookup_answer("tacit")) == get_colors_index("-----"));
-  assert(get_colors(lookup_guess("magic"), lookup_answer("tacit")) == get_colors_index("-!-!+"));
-  assert(get_colors(lookup_guess("tacit"), lookup_answer("tacit")) == get_colors_index("!!!!!"));
+
+  // An open tile store's computed tiles move to the new indices, and
+  // only the added column is computed.
+  {
+    TILE_STORE_PATH = tile_path;
+    open_tile_store();
+    const int thorn = lookup_answer("thorn");
+    int colors;
+    colors_row(lookup_guess("reast"), &thorn, 1, &colors);
+    assert(update_dictionary({{}, {}, {}, {"aback"}}));
+    const int moved = lookup_answer("thorn");
+    assert(moved != thorn);
+    colors_row(lookup_guess("reast"), &moved, 1, &colors);
+    assert(colors == reast_thorn);
+    assert(update_dictionary({{}, {}, {"aback"}, {}}));
+    const int aback = lookup_answer("aback");
+    colors_row(lookup_guess("reast"), &aback, 1, &colors);
+    assert(colors == get_colors_index("--!--"));
+    assert(TILE_STORE->tiles_computed() == 0);
+    // The file is kept for the new lists.
+    open_tile_store();
+    colors_row(lookup_guess("reast"), &moved, 1, &colors);
+    assert(colors == reast_thorn);
+    assert(TILE_STORE->tiles_computed() == 0);
+    TILE_STORE.reset();
+    TILE_STORE_PATH.clear();
+    unlink(tile_path);
+  }
+
+  // A locality layout keeps each word's colors and its word list
+  // position, and what reast leaves is a range of columns.
+  {
+    const std::vector<Word> words(GUESSES.begin(), GUESSES.end());
+    const std::string key = dictionary_key();
+    const std::string layout = layout_key();
+    reorder_dictionary("reast");
+    // Files keyed by words still apply; those keyed by index don't.
+    assert(dictionary_key() == key);
+    assert(layout_key() != layout);
+    for (int i = 0; i < GUESSES.size(); i++) {
+      assert(GUESSES[i] == words[DICTIONARY->guess_words[i]].c_str());
+    }
+    assert(get_colors(lookup_guess("reast"), lookup_answer("thorn")) == reast_thorn);
+    std::vector<int> left;
+    for (int i = 0; i < ANSWERS.size(); i++) {
+      if (possible_answer(i, {make_outcome("reast", "---+-")})) {
+	left.push_back(i);
+      }
+    }
+    assert(left.back() - left.front() + 1 == left.size());
+    assert(GUESSES[ANSWER_GUESSES[lookup_answer("thorn")]] == "thorn");
+    // Updates keep the layout and renumber the word list positions.
+    assert(update_dictionary({{"zzzzz"}, {}, {}, {"thorn"}}));
+    assert(DICTIONARY->guess_words.back() == GUESSES.size() - 1);
+    std::vector<int> answer_words = DICTIONARY->answer_words;
+    std::sort(answer_words.begin(), answer_words.end());
+    for (int i = 0; i < answer_words.size(); i++) {
+      assert(answer_words[i] == i);
+    }
+  }
 
   printf("All tests pass!\n");
 }
@@ -376,12 +4439,884 @@ void simulate_game(const std::string& answer_string) {
   };
 }
 
-int main(int argc, char** argv) {
+// Searches each history, given as guess:colors,guess:colors..., as a
+// session of its own on a SearchScheduler, and prints each answer and
+// how long it took to come back once all were submitted.
+void run_sessions(int num_threads, long long slice_nodes, int max_depth,
+		  const std::vector<std::string>& histories) {
+  const std::vector<int> all_answers = all_answer_indices();
+  SearchScheduler scheduler(num_threads, slice_nodes);
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<int> ids;
+  for (const std::string& history : histories) {
+    std::vector<Outcome> outcomes;
+    bool valid = true;
+    for (size_t begin = 0; valid && begin < history.size();) {
+      size_t end = history.find(',', begin);
+      if (end == std::string::npos) {
+	end = history.size();
+      }
+      Outcome outcome;
+      valid = parse_outcome(history.substr(begin, end - begin), &outcome);
+      outcomes.push_back(outcome);
+      begin = end + 1;
+    }
+    if (!valid) {
+      printf("%s: bad history, expected guess:colors,guess:colors...\n", history.c_str());
+      ids.push_back(-1);
+      continue;
+    }
+    const std::vector<int> answers = filter_answers(all_answers, outcomes);
+    if (answers.empty()) {
+      printf("%s: No POSSIBLE ANSWERS\n", history.c_str());
+      ids.push_back(-1);
+      continue;
+    }
+    ids.push_back(scheduler.submit(DICTIONARY, GUESS_POOL, answers, max_depth));
+  }
+  // Sessions finish in any order; report them as they do. The waiting
+  // threads have no tables of their own.
+  const Table<Word>& guesses = GUESSES;
+  std::vector<std::thread> waiters;
+  std::mutex print_mutex;
+  for (int i = 0; i < ids.size(); i++) {
+    if (ids[i] < 0) {
+      continue;
+    }
+    waiters.emplace_back([&, i]() {
+      std::pair<int, double> result;
+      scheduler.wait(ids[i], &result);
+      const double seconds = std::chrono::duration<double>(
+	std::chrono::steady_clock::now() - start).count();
+      std::lock_guard<std::mutex> lock(print_mutex);
+      printf("%s: %s  %g  (%.3fs)\n", histories[i].c_str(), guesses[result.first].c_str(),
+	     result.second, seconds);
+      fflush(stdout);
+    });
+  }
+  for (std::thread& waiter : waiters) {
+    waiter.join();
+  }
+}
+
+// Suggests guesses for a game played elsewhere. Each line of input is
+// a guess that was made and the colors it got, e.g. "reast ---+-".
+void interactive(int max_depth) {
+  std::vector<Outcome> outcomes;
+  char guess[64], colors[64];
+  while (scanf("%63s %63s", guess, colors) == 2) {
+    const int index = find_guess(guess);
+    if (index < 0 || strlen(colors) != WORD_LENGTH ||
+	strspn(colors, "-+!") != WORD_LENGTH) {
+      printf("Expected a guess and its colors, e.g. reast ---+-\n");
+      continue;
+    }
+    outcomes.push_back({index, get_colors_index(colors)});
+    solve(outcomes, max_depth);
+    fflush(stdout);
+  }
+}
+
+void write_leaderboard(const std::string& report_path,
+		       const std::vector<std::pair<int, double>>& scores) {
+  std::vector<std::pair<int, double>> sorted = scores;
+  std::stable_sort(sorted.begin(), sorted.end(), [](auto &left, auto &right) {
+    return left.second < right.second;
+  });
+  const std::string tmp_path = report_path + ".tmp";
+  FILE* f = fopen(tmp_path.c_str(), "w");
+  if (f == nullptr) {
+    perror(tmp_path.c_str());
+    exit(1);
+  }
+  for (int i = 0; i < sorted.size(); i++) {
+    fprintf(f, "%5d %s %.6f\n", i + 1, GUESSES[sorted[i].first].c_str(), sorted[i].second);
+  }
+  fclose(f);
+  rename(tmp_path.c_str(), report_path.c_str());
+}
+
+// Scores every allowed guess as an opener, searching max_depth
+// further guesses, and writes them best first to report_path. The
+// report is rewritten as results come in. Finished openers are kept in
+// report_path.ckpt so an interrupted run can be restarted. Openers
+// often leave some of the same buckets, e.g. anagrams leave the same
+// "-----" bucket, so each bucket is searched once per process through
+// SUBTREE_MEMO; with workers, each keeps its own.
+void leaderboard(int max_depth, const std::string& report_path) {
+  const std::vector<int> all_answers = all_answer_indices();
+  std::vector<int> all_guesses;
+  for (int i = 0; i < GUESSES.size(); i++) {
+    all_guesses.push_back(i);
+  }
+
+  const std::string key = "leaderboard max_depth=" + std::to_string(max_depth) +
+    " " + options_key() +
+    " " + dictionary_key();
+  Checkpoint checkpoint(report_path + ".ckpt", key);
+  std::unordered_map<std::string, std::pair<int, double>> memo;
+  SUBTREE_MEMO = &memo;
+  std::vector<std::pair<int, double>> scores;
+  time_t last_write = time(nullptr);
+  const std::vector<int> failed =
+    score_candidates(all_guesses, all_guesses, all_answers, 0, max_depth, &checkpoint,
+		     [&](int i, double score) {
+    scores.push_back({all_guesses[i], score});
+    if (time(nullptr) - last_write >= 10) {
+      write_leaderboard(report_path, scores);
+      last_write = time(nullptr);
+      printf("%d/%d openers scored.\n", scores.size(), all_guesses.size());
+    }
+  });
+  SUBTREE_MEMO = nullptr;
+  write_leaderboard(report_path, scores);
+  printf("Wrote %s.\n", report_path.c_str());
+  if (!failed.empty()) {
+    fprintf(stderr, "%d openers left out; their searches died.\n", failed.size());
+  }
+}
+
+// Calibrates LEAF_VALUES and writes them to path as leaf_values.h.
+// Samples up to samples_per_size answer subsets of each size from 2 to
+// max_size, taken from the buckets of random one- and two-guess
+// openings, and solves each exactly. A bigger set never takes fewer
+// guesses on average, so where the sample means dip the table is made
+// monotone by pooling neighbours, weighted by samples. The values past
+// max_size come from a least-squares fit of value against log(size)
+// over the upper half of the table.
+void calibrate(int max_size, int samples_per_size, const std::string& path) {
+  const bool verbose = VERBOSE;
+  VERBOSE = false;
+
+  const std::vector<int> all_answers = all_answer_indices();
+  const std::vector<int> all_guesses = search_guesses();
+  std::mt19937 rng(max_size);
+  std::uniform_int_distribution<int> random_guess(0, GUESSES.size() - 1);
+  std::vector<std::vector<std::vector<int>>> subsets(max_size + 1);
+  for (int trial = 0; trial < 1000; trial++) {
+    for (const auto& first : split_answers(random_guess(rng), all_answers)) {
+      for (const auto& second : split_answers(random_guess(rng), first.second)) {
+	const int n = second.second.size();
+	if (n >= 2 && n <= max_size && subsets[n].size() < samples_per_size) {
+	  subsets[n].push_back(second.second);
+	}
+      }
+    }
+  }
+
+  std::unordered_map<std::string, std::pair<int, double>> memo;
+  std::vector<double> values = {0, 0};  // Sizes 0 and 1.
+  for (int n = 2; n <= max_size && !subsets[n].empty(); n++) {
+    double total = 0;
+    for (const std::vector<int>& subset : subsets[n]) {
+      total += solve_exact(all_guesses, subset, &memo).second;
+    }
+    values.push_back(total / subsets[n].size());
+    printf("%3d answers: %g (%d samples)\n", n, values.back(), subsets[n].size());
+  }
+
+  // Pool adjacent violators: each block is a run of sizes sharing the
+  // weighted mean of their samples, merged with the one before it
+  // until the means increase.
+  struct Block {
+    double mean;
+    int weight;
+    int sizes;
+  };
+  std::vector<Block> blocks;
+  for (int n = 0; n < values.size(); n++) {
+    blocks.push_back({values[n], n < 2 ? 1 : static_cast<int>(subsets[n].size()), 1});
+    while (blocks.size() > 1 && blocks[blocks.size() - 2].mean > blocks.back().mean) {
+      const Block last = blocks.back();
+      blocks.pop_back();
+      Block& merged = blocks.back();
+      merged.mean = (merged.mean * merged.weight + last.mean * last.weight) /
+	(merged.weight + last.weight);
+      merged.weight += last.weight;
+      merged.sizes += last.sizes;
+    }
+  }
+  values.clear();
+  for (const Block& block : blocks) {
+    values.insert(values.end(), block.sizes, block.mean);
+  }
+
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  int count = 0;
+  for (int n = values.size() / 2; n < values.size(); n++) {
+    const double x = std::log(n);
+    sx += x;
+    sy += values[n];
+    sxx += x * x;
+    sxy += x * values[n];
+    count++;
+  }
+  const double slope = (count * sxy - sx * sy) / (count * sxx - sx * sx);
+  const double intercept = (sy - slope * sx) / count;
+
+  FILE* f = fopen(path.c_str(), "w");
+  if (f == nullptr) {
+    perror(path.c_str());
+    exit(1);
+  }
+  fprintf(f, "// Generated by `wordle4 calibrate %d %d`. Do not edit.\n",
+	  max_size, samples_per_size);
+  fprintf(f, "// Expected guesses after the next one to solve n answers, by n.\n");
+  fprintf(f, "constexpr double EMBEDDED_LEAF_VALUES[] = {\n");
+  for (int n = 0; n < values.size(); n++) {
+    fprintf(f, "  %.6f,  // %d\n", values[n], n);
+  }
+  fprintf(f, "};\n");
+  fprintf(f, "// Past the table: intercept + slope * log(n).\n");
+  fprintf(f, "constexpr double LEAF_VALUE_INTERCEPT = %.6f;\n", intercept);
+  fprintf(f, "constexpr double LEAF_VALUE_SLOPE = %.6f;\n", slope);
+  fclose(f);
+  printf("Wrote %s. Past %d answers: %g + %g * log(n)\n",
+	 path.c_str(), values.size() - 1, intercept, slope);
+  VERBOSE = verbose;
+}
+
+// Writes the guesses worth searching to path. If a's partition of all
+// the answers refines b's, it refines b's partition of every subset too,
+// so a is at least as good as b at every node and b can be dropped from
+// every search. Answers are always kept, since b's winning bucket is
+// worth more than the singleton a leaves in its place. Of guesses that
+// partition identically, the first is kept. The file starts with the
+// dictionary it was computed for.
+void reduce_guesses(const std::string& path) {
+  const std::vector<int> all_answers = all_answer_indices();
+  const int n = ANSWERS.size();
+  printf("Computing colors.\n");
+  std::vector<uint16_t> matrix(GUESSES.size() * n);
+  std::vector<int> colors(n);
+  std::vector<int> num_buckets(GUESSES.size());
+  for (int guess = 0; guess < GUESSES.size(); guess++) {
+    colors_row(guess, all_answers.data(), n, colors.data());
+    std::copy(colors.begin(), colors.end(), matrix.begin() + guess * n);
+    std::sort(colors.begin(), colors.end());
+    num_buckets[guess] = std::unique(colors.begin(), colors.end()) - colors.begin();
+  }
+  auto row = [&](int guess) { return &matrix[guess * n]; };
+  std::vector<bool> is_answer(GUESSES.size());
+  for (int answer = 0; answer < n; answer++) {
+    is_answer[ANSWER_GUESSES[answer]] = true;
+  }
+
+  printf("Grouping identical partitions.\n");
+  std::vector<bool> kept(GUESSES.size(), true);
+  std::vector<int> representatives;  // First of each partition.
+  std::unordered_map<std::string, std::vector<int>> by_signature;
+  int num_equivalent = 0;
+  for (int guess = 0; guess < GUESSES.size(); guess++) {
+    const std::vector<int> signature = split_signature(guess, all_answers);
+    std::vector<int>& group = by_signature[hash_key(std::string(
+      reinterpret_cast<const char*>(signature.data()), signature.size() * sizeof(int)))];
+    const bool equivalent = std::any_of(group.begin(), group.end(), [&](int other) {
+      return num_buckets[other] == num_buckets[guess] && refines(row(other), row(guess), n);
+    });
+    if (!equivalent) {
+      group.push_back(guess);
+      representatives.push_back(guess);
+    } else if (!is_answer[guess]) {
+      kept[guess] = false;
+      num_equivalent++;
+    }
+  }
+
+  printf("Checking %d partitions for refinement.\n", representatives.size());
+  std::sort(representatives.begin(), representatives.end(), [&](int left, int right) {
+    return num_buckets[left] > num_buckets[right];
+  });
+  int num_refined = 0;
+  for (int j = 0; j < representatives.size(); j++) {
+    const int guess = representatives[j];
+    if (is_answer[guess]) {
+      continue;
+    }
+    // Only a partition with more buckets can strictly refine this one.
+    for (int i = 0; i < j && num_buckets[representatives[i]] > num_buckets[guess]; i++) {
+      if (refines(row(representatives[i]), row(guess), n)) {
+	kept[guess] = false;
+	num_refined++;
+	break;
+      }
+    }
+  }
+
+  FILE* f = fopen(path.c_str(), "w");
+  if (f == nullptr) {
+    perror(path.c_str());
+    exit(1);
+  }
+  fprintf(f, "key %s\n", dictionary_key().c_str());
+  int num_kept = 0;
+  for (int guess = 0; guess < GUESSES.size(); guess++) {
+    if (kept[guess]) {
+      fprintf(f, "%s\n", GUESSES[guess].c_str());
+      num_kept++;
+    }
+  }
+  fclose(f);
+  printf("Wrote %s. %d guesses: %d partition like an earlier one, %d are refined "
+	 "by another, %d kept.\n", path.c_str(), GUESSES.size(), num_equivalent,
+	 num_refined, num_kept);
+}
+
+// Builds a tablebase of the answer sets of up to max_size that come up
+// when playing the solver's own policy, searching max_depth deep, after
+// outcomes: larger sets are split by the guess best_guess() picks, and
+// sets that are small enough are solved exactly, along with the sets
+// their exact solutions lead to. Writes it to path, one
+// "key size guess score answers..." line per set.
+void build_tablebase(int max_size, int max_depth, const std::vector<Outcome>& outcomes,
+		     const std::string& path) {
+  assert(max_size <= TABLEBASE_MAX_ANSWERS);
+  const bool verbose = VERBOSE;
+  VERBOSE = false;
+  const std::vector<int> guesses = search_guesses();
+  std::unordered_map<std::string, std::pair<int, double>> memo;
+  std::map<std::vector<std::string>, std::pair<int, double>> entries;
+  std::function<void(const std::vector<int>&)> add_exact = [&](const std::vector<int>& answers) {
+    const std::vector<std::string> words = tablebase_words(answers);
+    if (answers.size() < 2 || entries.count(words)) {
+      return;
+    }
+    const auto result = solve_exact(guesses, answers, &memo);
+    entries[words] = result;
+    for (const auto& bucket : split_answers(result.first, answers)) {
+      add_exact(bucket.second);
+    }
+  };
+  std::function<void(const std::vector<int>&)> walk = [&](const std::vector<int>& answers) {
+    if (answers.size() <= max_size) {
+      add_exact(answers);
+      return;
+    }
+    const int guess = best_guess(guesses, answers, 0, max_depth).first;
+    printf("%d answers: %s\n", answers.size(), GUESSES[guess].c_str());
+    fflush(stdout);
+    for (const auto& bucket : split_answers(guess, answers)) {
+      if (bucket.first != 682) {
+	walk(bucket.second);
+      }
+    }
+  };
+  const std::vector<int> all_answers = all_answer_indices();
+  walk(filter_answers(all_answers, outcomes));
+  VERBOSE = verbose;
+
+  FILE* f = fopen(path.c_str(), "w");
+  if (f == nullptr) {
+    perror(path.c_str());
+    exit(1);
+  }
+  for (const auto& entry : entries) {
+    fprintf(f, "%016llx %d %s %.9f", static_cast<unsigned long long>(tablebase_key(entry.first)),
+	    entry.first.size(), GUESSES[entry.second.first].c_str(), entry.second.second);
+    for (const std::string& word : entry.first) {
+      fprintf(f, " %s", word.c_str());
+    }
+    fprintf(f, "\n");
+  }
+  fclose(f);
+  printf("Wrote %s: %d answer sets.\n", path.c_str(), entries.size());
+}
+
+// Reads a tablebase written by build_tablebase() into TABLEBASE. Each
+// line's key and size must match its answers, which must be sorted, or
+// the file is from something else.
+void load_tablebase(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    perror(path.c_str());
+    exit(1);
+  }
+  std::string line, contents;
+  for (int number = 1; std::getline(in, line); number++) {
+    unsigned long long key;
+    int size, used = 0;
+    TablebaseEntry entry;
+    bool valid = sscanf(line.c_str(), "%llx %d %5s %lf%n", &key, &size, entry.guess.letters,
+			&entry.score, &used) == 4 &&
+      size >= 2 && size <= TABLEBASE_MAX_ANSWERS && valid_word(entry.guess.c_str()) &&
+      std::isfinite(entry.score);
+    for (char* word = strtok(&line[used], " \t"); valid && word != nullptr;
+	 word = strtok(nullptr, " \t")) {
+      valid = valid_word(word) && (entry.answers.empty() || entry.answers.back() < word);
+      entry.answers.push_back(word);
+    }
+    if (!valid || entry.answers.size() != size || tablebase_key(entry.answers) != key) {
+      fprintf(stderr, "%s:%d: not a tablebase entry\n", path.c_str(), number);
+      exit(1);
+    }
+    contents += line + "\n";
+    TABLEBASE.emplace(key, std::move(entry));
+  }
+  TABLEBASE_KEY = hash_key(contents);
+}
+
+// Reads a pool written by reduce_guesses() into GUESS_POOL.
+void load_guess_pool(const std::string& path) {
+  std::ifstream f(path);
+  std::string line;
+  if (!f || !std::getline(f, line)) {
+    fprintf(stderr, "Can't read %s\n", path.c_str());
+    exit(1);
+  }
+  if (line != "key " + dictionary_key()) {
+    fprintf(stderr, "%s was reduced for another dictionary\n", path.c_str());
+    exit(1);
+  }
+  GUESS_POOL.clear();
+  while (std::getline(f, line)) {
+    const int guess = find_guess(line);
+    if (guess < 0) {
+      fprintf(stderr, "%s: unknown guess '%s'\n", path.c_str(), line.c_str());
+      exit(1);
+    }
+    GUESS_POOL.push_back(guess);
+  }
+}
+
+// C interface; see wordlitzer.h.
+
+// What init or load set up, which every thread calling in shares. Each
+// thread's search state is its own, so calls from different threads can
+// overlap.
+std::shared_ptr<Dictionary> API_DICTIONARY;
+
+void bind_api_dictionary() {
+  VERBOSE = false;
+  if (DICTIONARY != API_DICTIONARY) {
+    bind_dictionary(API_DICTIONARY);
+  }
+}
+
+int wordlitzer_init(void) {
   initialize_tables();
-  //simulate_game(ANSWERS[2100]);
-  play();
-  //test();
+  API_DICTIONARY = DICTIONARY;
+  return 0;
+}
+
+int wordlitzer_load(const char* guesses_path, const char* answers_path) {
+  std::string error;
+  std::shared_ptr<Dictionary> dictionary = read_dictionary(guesses_path, answers_path, &error);
+  if (dictionary == nullptr) {
+    return -1;
+  }
+  API_DICTIONARY = std::move(dictionary);
+  bind_api_dictionary();
+  return 0;
+}
+
+int wordlitzer_num_guesses(void) {
+  bind_api_dictionary();
+  return GUESSES.size();
+}
+
+int wordlitzer_num_answers(void) {
+  bind_api_dictionary();
+  return ANSWERS.size();
+}
+
+const char* wordlitzer_guess(int guess) {
+  bind_api_dictionary();
+  return guess >= 0 && guess < GUESSES.size() ? GUESSES[guess].c_str() : nullptr;
+}
+
+const char* wordlitzer_answer(int answer) {
+  bind_api_dictionary();
+  return answer >= 0 && answer < ANSWERS.size() ? ANSWERS[answer].c_str() : nullptr;
+}
+
+int wordlitzer_lookup_guess(const char* word) {
+  bind_api_dictionary();
+  return find_guess(word);
+}
+
+int wordlitzer_lookup_answer(const char* word) {
+  bind_api_dictionary();
+  return find_answer(word);
+}
+
+// Looks up each WORD_LENGTH letter word in words with find, and returns
+// how many it found.
+int lookup_words(const char* words, int num_words, int* indices,
+		 int (*find)(const std::string&)) {
+  int num_found = 0;
+  for (int i = 0; i < num_words; i++) {
+    indices[i] = find(std::string(words + i * WORD_LENGTH, WORD_LENGTH));
+    num_found += indices[i] >= 0;
+  }
+  return num_found;
+}
+
+int wordlitzer_lookup_guesses(const char* words, int num_words, int* indices) {
+  bind_api_dictionary();
+  return lookup_words(words, num_words, indices, find_guess);
+}
+
+int wordlitzer_lookup_answers(const char* words, int num_words, int* indices) {
+  bind_api_dictionary();
+  return lookup_words(words, num_words, indices, find_answer);
+}
+
+int wordlitzer_colors_index(const char* colors) {
+  if (strlen(colors) != WORD_LENGTH || strspn(colors, "-+!") != WORD_LENGTH) {
+    return -1;
+  }
+  return get_colors_index(colors);
+}
+
+int wordlitzer_colors(int guess, int answer) {
+  bind_api_dictionary();
+  if (guess < 0 || guess >= GUESSES.size() || answer < 0 || answer >= ANSWERS.size()) {
+    return -1;
+  }
+  return get_colors(guess, answer);
+}
+
+// Whether all num_indices indices are in [0, size).
+bool valid_indices(const int* indices, int num_indices, int size) {
+  for (int i = 0; i < num_indices; i++) {
+    if (indices[i] < 0 || indices[i] >= size) {
+      return false;
+    }
+  }
+  return num_indices >= 0;
+}
+
+std::vector<Outcome> make_outcomes(const int* outcome_guesses, const int* outcome_colors,
+				   int num_outcomes) {
+  std::vector<Outcome> outcomes;
+  for (int i = 0; i < num_outcomes; i++) {
+    outcomes.push_back({outcome_guesses[i], outcome_colors[i]});
+  }
+  return outcomes;
+}
+
+int wordlitzer_filter(const int* outcome_guesses, const int* outcome_colors,
+		      int num_outcomes, int* answers) {
+  bind_api_dictionary();
+  if (!valid_indices(outcome_guesses, num_outcomes, GUESSES.size())) {
+    return -1;
+  }
+  const std::vector<Outcome> outcomes =
+    make_outcomes(outcome_guesses, outcome_colors, num_outcomes);
+  int num_answers = 0;
+  for (int answer = 0; answer < ANSWERS.size(); answer++) {
+    if (possible_answer(answer, outcomes)) {
+      answers[num_answers++] = answer;
+    }
+  }
+  return num_answers;
+}
+
+int wordlitzer_score_guesses(const int* guesses, int num_guesses,
+			     const int* answers, int num_answers,
+			     double* scores) {
+  bind_api_dictionary();
+  if (!valid_indices(guesses, num_guesses, GUESSES.size()) ||
+      !valid_indices(answers, num_answers, ANSWERS.size())) {
+    return -1;
+  }
+  const std::vector<int> answer_list(answers, answers + num_answers);
+  for (int i = 0; i < num_guesses; i++) {
+    scores[i] = score_guess(guesses[i], {}, answer_list);
+  }
+  return 0;
+}
+
+int wordlitzer_score_guesses_batch(const int* guesses, int num_guesses,
+				   const int* answers, const int* subset_sizes,
+				   int num_subsets, double* scores) {
+  bind_api_dictionary();
+  if (!valid_indices(guesses, num_guesses, GUESSES.size()) || num_subsets < 0) {
+    return -1;
+  }
+  const std::vector<int> guess_list(guesses, guesses + num_guesses);
+  std::vector<std::vector<int>> subsets;
+  for (int s = 0; s < num_subsets; s++) {
+    if (!valid_indices(answers, subset_sizes[s], ANSWERS.size())) {
+      return -1;
+    }
+    subsets.emplace_back(answers, answers + subset_sizes[s]);
+    answers += subset_sizes[s];
+  }
+  const auto batch_scores = score_guesses_batch(guess_list, subsets);
+  for (int s = 0; s < num_subsets; s++) {
+    std::copy(batch_scores[s].begin(), batch_scores[s].end(), scores + s * num_guesses);
+  }
+  return 0;
+}
+
+int wordlitzer_solve(const int* outcome_guesses, const int* outcome_colors,
+		     int num_outcomes, int max_depth, double* score) {
+  bind_api_dictionary();
+  std::vector<int> answers(ANSWERS.size());
+  const int num_answers =
+    wordlitzer_filter(outcome_guesses, outcome_colors, num_outcomes, answers.data());
+  if (num_answers <= 0) {
+    return -1;
+  }
+  answers.resize(num_answers);
+  const std::vector<int> all_guesses = search_guesses();
+  auto result = best_guess(all_guesses, answers, 0, max_depth);
+  if (score != nullptr) {
+    *score = result.second;
+  }
+  return result.first;
+}
+
+#ifndef WORDLITZER_LIBRARY
+int main(int argc, char** argv) {
+  std::vector<std::string> args;
+  std::string guesses_path;
+  std::string answers_path;
+  std::string trace_path;
+  std::string guess_pool_path;
+  bool speculate = false;
+  bool numa = false;
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] != '-') {
+      args.push_back(argv[i]);
+      continue;
+    }
+    if (sscanf(argv[i], "--workers=%d", &NUM_WORKERS) == 1) {
+      continue;
+    }
+    if (strncmp(argv[i], "--trace=", 8) == 0) {
+      trace_path = argv[i] + 8;
+      continue;
+    }
+    if (strcmp(argv[i], "--no_leaf_estimator") == 0) {
+      LEAF_ESTIMATOR = false;
+      continue;
+    }
+    if (strcmp(argv[i], "--locality_order") == 0) {
+      LOCALITY_OPENER = "reast";
+      continue;
+    }
+    if (strncmp(argv[i], "--locality_order=", 17) == 0) {
+      LOCALITY_OPENER = argv[i] + 17;
+      continue;
+    }
+    if (strcmp(argv[i], "--numa") == 0) {
+      numa = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--matrix_free") == 0) {
+      MATRIX_FREE = true;
+      continue;
+    }
+    if (strncmp(argv[i], "--tile_store=", 13) == 0) {
+      TILE_STORE_PATH = argv[i] + 13;
+      continue;
+    }
+    if (sscanf(argv[i], "--tile_cache_mb=%d", &TILE_CACHE_MB) == 1) {
+      continue;
+    }
+    if (strcmp(argv[i], "--speculate") == 0) {
+      speculate = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--incremental_scores") == 0) {
+      INCREMENTAL_SCORES = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--successive_halving") == 0) {
+      SUCCESSIVE_HALVING = true;
+      continue;
+    }
+    if (strncmp(argv[i], "--guesses=", 10) == 0) {
+      guesses_path = argv[i] + 10;
+      continue;
+    }
+    if (strncmp(argv[i], "--answers=", 10) == 0) {
+      answers_path = argv[i] + 10;
+      continue;
+    }
+    if (strncmp(argv[i], "--tablebase=", 12) == 0) {
+      load_tablebase(argv[i] + 12);
+      continue;
+    }
+    if (strncmp(argv[i], "--guess_pool=", 13) == 0) {
+      guess_pool_path = argv[i] + 13;
+      continue;
+    }
+    if (strncmp(argv[i], "--checkpoint_dir=", 17) == 0) {
+      CHECKPOINT_DIR = argv[i] + 17;
+      continue;
+    }
+    fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+    return 1;
+  }
+  if (guesses_path.empty() != answers_path.empty()) {
+    fprintf(stderr, "--guesses and --answers go together\n");
+    return 1;
+  }
+  Tracer tracer;
+  if (!trace_path.empty()) {
+    TRACER = &tracer;
+  }
+  if (guesses_path.empty()) {
+    initialize_tables();
+  } else {
+    load_tables(guesses_path, answers_path);
+  }
+  if (!LOCALITY_OPENER.empty()) {
+    reorder_dictionary(LOCALITY_OPENER);
+  }
+  if (numa) {
+    NUMA_NODES = read_numa_nodes();
+    if (NUMA_NODES.size() > 1) {
+      replicate_colors_cache(DICTIONARY.get(), NUMA_NODES);
+      printf("Replicated the tables on %d NUMA nodes.\n", NUMA_NODES.size());
+    } else {
+      printf("One NUMA node; keeping one copy of the tables.\n");
+      NUMA_NODES.clear();
+    }
+  }
+  if (!TILE_STORE_PATH.empty()) {
+    open_tile_store();
+  }
+  if (!guess_pool_path.empty()) {
+    load_guess_pool(guess_pool_path);
+  }
+  Speculator speculator;
+  if (speculate) {
+    SPECULATOR = &speculator;
+  }
+  // The guess:colors arguments from args[first] on.
+  std::vector<Outcome> outcomes;
+  auto parse_outcomes = [&](int first) {
+    for (int i = first; i < args.size(); i++) {
+      Outcome outcome;
+      if (!parse_outcome(args[i], &outcome)) {
+	fprintf(stderr, "Expected guess:colors, e.g. reast:---+-, not '%s'\n", args[i].c_str());
+	return false;
+      }
+      outcomes.push_back(outcome);
+    }
+    return true;
+  };
+  if (!args.empty() && args[0] == "leaderboard") {
+    // leaderboard [max_depth] [report_path]
+    leaderboard(args.size() > 1 ? atoi(args[1].c_str()) : 1,
+		args.size() > 2 ? args[2] : "leaderboard.txt");
+  } else if (!args.empty() && args[0] == "update") {
+    // update {add,remove}_{guess,answer}:WORD...
+    // Edits the word lists given by --guesses and --answers, and the
+    // --tile_store file if there is one: its computed tiles move to the
+    // new indices and only the added rows and columns are computed, so
+    // later runs with the new lists start from it. The compiled-in
+    // tables are made from wordle_allowed_words.txt and
+    // wordle_answers.txt, so after editing those, rebuild with make.
+    if (guesses_path.empty()) {
+      fprintf(stderr, "update needs --guesses and --answers\n");
+      return 1;
+    }
+    DictionaryUpdate update;
+    for (int i = 1; i < args.size(); i++) {
+      const size_t colon = args[i].find(':');
+      const std::string change = args[i].substr(0, colon);
+      const std::string word = colon == std::string::npos ? "" : args[i].substr(colon + 1);
+      if (change == "add_guess") {
+	update.add_guesses.push_back(word);
+      } else if (change == "remove_guess") {
+	update.remove_guesses.push_back(word);
+      } else if (change == "add_answer") {
+	update.add_answers.push_back(word);
+      } else if (change == "remove_answer") {
+	update.remove_answers.push_back(word);
+      } else {
+	fprintf(stderr, "Bad update: %s\n", args[i].c_str());
+	return 1;
+      }
+    }
+    const clock_t start = clock();
+    if (!update_dictionary(update)) {
+      return 1;
+    }
+    printf("Updated tables in %.3fms. %d guesses, %d answers.\n",
+	   1000.0 * (clock() - start) / CLOCKS_PER_SEC, GUESSES.size(), ANSWERS.size());
+    patch_word_list(guesses_path, update.add_guesses, update.remove_guesses);
+    patch_word_list(answers_path, update.add_answers, update.remove_answers);
+    printf("Wrote %s and %s. Run make to compile them in if they're the built-in "
+	   "lists.\n", guesses_path.c_str(), answers_path.c_str());
+    if (TILE_STORE) {
+      printf("Patched %s for the new lists.\n", TILE_STORE_PATH.c_str());
+    }
+  } else if (!args.empty() && args[0] == "calibrate") {
+    // calibrate [max_size] [samples_per_size] [path]
+    calibrate(args.size() > 1 ? atoi(args[1].c_str()) : 40,
+	      args.size() > 2 ? atoi(args[2].c_str()) : 64,
+	      args.size() > 3 ? args[3] : "leaf_values.h");
+  } else if (!args.empty() && args[0] == "interactive") {
+    // interactive [max_depth], then "guess colors" lines on stdin.
+    interactive(args.size() > 1 ? atoi(args[1].c_str()) : 3);
+  } else if (!args.empty() && args[0] == "tablebase") {
+    // tablebase [max_size] [max_depth] [path] [guess:colors...]
+    if (!parse_outcomes(4)) {
+      return 1;
+    }
+    build_tablebase(args.size() > 1 ? atoi(args[1].c_str()) : TABLEBASE_MAX_ANSWERS,
+		    args.size() > 2 ? atoi(args[2].c_str()) : 0, outcomes,
+		    args.size() > 3 ? args[3] : "tablebase.txt");
+  } else if (!args.empty() && args[0] == "reduce_guesses") {
+    // reduce_guesses [path]
+    reduce_guesses(args.size() > 1 ? args[1] : "guess_pool.txt");
+  } else if (!args.empty() && (args[0] == "worst_case" || args[0] == "absurdle")) {
+    // {worst_case,absurdle} [max_guesses] [guess:colors...]
+    if (!parse_outcomes(2)) {
+      return 1;
+    }
+    solve_worst_case(outcomes, args.size() > 1 ? atoi(args[1].c_str()) : 6,
+		     args[0] == "absurdle");
+  } else if (!args.empty() && args[0] == "batch") {
+    // batch <histories file> [max_depth]
+    if (args.size() < 2) {
+      fprintf(stderr, "batch needs a file of histories\n");
+      return 1;
+    }
+    batch_solve(args[1], args.size() > 2 ? atoi(args[2].c_str()) : 3);
+  } else if (!args.empty() && args[0] == "mcts") {
+    // mcts [iterations] [milliseconds] [guess:colors...]
+    // 0 lifts a budget, but one of them has to stay.
+    if (!parse_outcomes(3)) {
+      return 1;
+    }
+    const int iterations = args.size() > 1 ? atoi(args[1].c_str()) : 10000;
+    const int milliseconds = args.size() > 2 ? atoi(args[2].c_str()) : 0;
+    if (iterations <= 0 && milliseconds <= 0) {
+      fprintf(stderr, "mcts needs a number of playouts or milliseconds\n");
+      return 1;
+    }
+    solve_mcts(outcomes, iterations, milliseconds);
+  } else if (!args.empty() && args[0] == "sessions") {
+    // sessions threads slice_nodes max_depth guess:colors,...  ...
+    if (args.size() < 5) {
+      fprintf(stderr, "Usage: sessions threads slice_nodes max_depth history...\n");
+      return 1;
+    }
+    run_sessions(atoi(args[1].c_str()), atoll(args[2].c_str()), atoi(args[3].c_str()),
+		 std::vector<std::string>(args.begin() + 4, args.end()));
+  } else if (!args.empty() && args[0] == "test") {
+    test();
+  } else {
+    //simulate_game(ANSWERS[2100]);
+    play();
+    //test();
+  }
+  if (TRACER) {
+    TRACER->write(trace_path);
+  }
   printf("CACHE_HITS: %ld, MISSES: %ld, HIT_RATE: %g\n",
 	 CACHE_HITS, CACHE_MISSES, static_cast<double>(CACHE_HITS) / (CACHE_HITS + CACHE_MISSES));
+  if (TILE_STORE) {
+    printf("TILES_MAPPED: %lld, COMPUTED: %lld\n",
+	   TILE_STORE->tiles_mapped(), TILE_STORE->tiles_computed());
+  }
   return 0;
 }
+#endif  // WORDLITZER_LIBRARY
@@ -0,0 +1,90 @@
+// C interface to the wordle4 engine, built as libwordlitzer.so by
+// `make libwordlitzer.so`.
+//
+// Guesses and answers are indices into the guess and answer lists, and
+// colors are indices as returned by wordlitzer_colors_index(). Calls
+// taking indices check them and return -1 if any is out of range. Lists
+// are passed as flat int arrays so callers (e.g. Python's ctypes) can
+// hand over whole lists at once. An outcome history is two parallel
+// arrays of guesses and the colors they got.
+//
+// Calls from different threads may overlap: they share the tables set
+// up by wordlitzer_init() or wordlitzer_load(), but each thread keeps
+// its own search state. Init and load themselves must not overlap
+// other calls.
+
+#ifndef WORDLITZER_H
+#define WORDLITZER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sets up the word lists compiled into the library. Returns 0.
+int wordlitzer_init(void);
+
+// Loads word lists from files instead. Returns 0, or -1 without
+// changing anything if either can't be read, has a word that isn't
+// five lowercase letters, or an answer isn't also a guess.
+int wordlitzer_load(const char* guesses_path, const char* answers_path);
+
+int wordlitzer_num_guesses(void);
+int wordlitzer_num_answers(void);
+
+// Returns the word, or NULL if the index is out of range.
+const char* wordlitzer_guess(int guess);
+const char* wordlitzer_answer(int answer);
+
+// Return the index of the word, or -1 if it isn't in the list.
+int wordlitzer_lookup_guess(const char* word);
+int wordlitzer_lookup_answer(const char* word);
+
+// Look up num_words words at once. words holds them back to back, five
+// letters each with nothing in between, e.g. "reastplink". Writes each
+// one's index, or -1, to indices[num_words] and returns how many were
+// found.
+int wordlitzer_lookup_guesses(const char* words, int num_words, int* indices);
+int wordlitzer_lookup_answers(const char* words, int num_words, int* indices);
+
+// Converts colors like "-+!--" to an index, or -1 if malformed. 682 is
+// "!!!!!".
+int wordlitzer_colors_index(const char* colors);
+
+// Colors guess gets if the word is answer, or -1 if either index is
+// out of range.
+int wordlitzer_colors(int guess, int answer);
+
+// Writes the answers consistent with the outcome history to answers,
+// which must have room for wordlitzer_num_answers() entries. Returns
+// how many there are, or -1 if a guess is out of range.
+int wordlitzer_filter(const int* outcome_guesses, const int* outcome_colors,
+		      int num_outcomes, int* answers);
+
+// Writes each guess's shallow score over the answers, the expected
+// number of answers left after it, to scores[num_guesses]. Returns 0,
+// or -1 without writing anything if an index is out of range.
+int wordlitzer_score_guesses(const int* guesses, int num_guesses,
+			     const int* answers, int num_answers,
+			     double* scores);
+
+// Like wordlitzer_score_guesses() for num_subsets answer subsets at
+// once, in one pass over the guesses. answers holds the subsets back to
+// back, subset_sizes[s] entries each. Subset s's score for guess g goes
+// to scores[s * num_guesses + g]. Returns 0, or -1 like
+// wordlitzer_score_guesses().
+int wordlitzer_score_guesses_batch(const int* guesses, int num_guesses,
+				   const int* answers, const int* subset_sizes,
+				   int num_subsets, double* scores);
+
+// Searches for the best next guess after the outcome history, like
+// wordle4's solve(). Returns the guess and stores its expected number
+// of further steps in *score if score isn't NULL. Returns -1 if no
+// answer fits the history or a guess in it is out of range.
+int wordlitzer_solve(const int* outcome_guesses, const int* outcome_colors,
+		     int num_outcomes, int max_depth, double* score);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // WORDLITZER_H
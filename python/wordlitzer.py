@@ -0,0 +1,135 @@
+"""ctypes bindings for libwordlitzer.so, the C++ engine in ../cpp.
+
+Build the library with `make libwordlitzer.so` in ../cpp, or point
+WORDLITZER_LIB at it. Words are passed in and out as strings; the
+lists are converted to flat int arrays in one go on the way through.
+
+  import wordlitzer
+  wordlitzer.init()
+  wordlitzer.solve([('reast', '---+-')], max_depth=1)
+"""
+
+import ctypes
+import os
+
+_LIB = ctypes.CDLL(os.environ.get(
+  'WORDLITZER_LIB',
+  os.path.join(os.path.dirname(os.path.abspath(__file__)),
+               '..', 'cpp', 'libwordlitzer.so')))
+
+_IntArray = ctypes.POINTER(ctypes.c_int)
+_DoubleArray = ctypes.POINTER(ctypes.c_double)
+
+_LIB.wordlitzer_load.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+_LIB.wordlitzer_guess.restype = ctypes.c_char_p
+_LIB.wordlitzer_answer.restype = ctypes.c_char_p
+_LIB.wordlitzer_lookup_guess.argtypes = [ctypes.c_char_p]
+_LIB.wordlitzer_lookup_answer.argtypes = [ctypes.c_char_p]
+_LIB.wordlitzer_lookup_guesses.argtypes = [ctypes.c_char_p, ctypes.c_int, _IntArray]
+_LIB.wordlitzer_lookup_answers.argtypes = [ctypes.c_char_p, ctypes.c_int, _IntArray]
+_LIB.wordlitzer_colors_index.argtypes = [ctypes.c_char_p]
+_LIB.wordlitzer_filter.argtypes = [_IntArray, _IntArray, ctypes.c_int, _IntArray]
+_LIB.wordlitzer_score_guesses.argtypes = [
+  _IntArray, ctypes.c_int, _IntArray, ctypes.c_int, _DoubleArray]
+_LIB.wordlitzer_score_guesses_batch.argtypes = [
+  _IntArray, ctypes.c_int, _IntArray, _IntArray, ctypes.c_int, _DoubleArray]
+_LIB.wordlitzer_solve.argtypes = [
+  _IntArray, _IntArray, ctypes.c_int, ctypes.c_int, _DoubleArray]
+
+COLORS = '-+!'
+
+
+def _ints(values):
+  return (ctypes.c_int * len(values))(*values)
+
+
+def _check(result):
+  """Raises if a call turned away an index out of range."""
+  if result == -1:
+    raise IndexError('Index out of range')
+  return result
+
+
+def _lookup(lookup, word):
+  index = lookup(word.encode())
+  if index < 0:
+    raise KeyError(word)
+  return index
+
+
+def _lookup_all(lookup, words):
+  """Looks up a list of words in one call, as a list of indices."""
+  words = list(words)
+  for word in words:
+    if len(word) != 5:
+      raise KeyError(word)
+  indices = (ctypes.c_int * len(words))()
+  if lookup(''.join(words).encode(), len(words), indices) != len(words):
+    raise KeyError(words[list(indices).index(-1)])
+  return list(indices)
+
+
+def init(guesses_path=None, answers_path=None):
+  """Uses the compiled-in word lists, or the given files."""
+  if guesses_path is None:
+    _LIB.wordlitzer_init()
+  elif _LIB.wordlitzer_load(guesses_path.encode(), answers_path.encode()) != 0:
+    raise IOError('Can\'t read %s or %s' % (guesses_path, answers_path))
+
+
+def _outcome_arrays(outcomes):
+  guesses = _lookup_all(_LIB.wordlitzer_lookup_guesses, [guess for guess, _ in outcomes])
+  colors = [_LIB.wordlitzer_colors_index(c.encode()) for _, c in outcomes]
+  if -1 in colors:
+    raise ValueError(outcomes)
+  return _ints(guesses), _ints(colors), len(outcomes)
+
+
+def colors(guess, answer):
+  """Returns the colors guess gets against answer, e.g. '-+!--'."""
+  index = _check(_LIB.wordlitzer_colors(_lookup(_LIB.wordlitzer_lookup_guess, guess),
+                                        _lookup(_LIB.wordlitzer_lookup_answer, answer)))
+  return ''.join(COLORS[(index >> (2 * i)) & 3] for i in reversed(range(5)))
+
+
+def filter_answers(outcomes):
+  """Returns the answers consistent with [(guess, colors), ...]."""
+  answers = (ctypes.c_int * _LIB.wordlitzer_num_answers())()
+  n = _check(_LIB.wordlitzer_filter(*_outcome_arrays(outcomes), answers))
+  return [_LIB.wordlitzer_answer(a).decode() for a in answers[:n]]
+
+
+def score_guesses(guesses, answers):
+  """Returns each guess's expected number of answers left."""
+  guess_array = _ints(_lookup_all(_LIB.wordlitzer_lookup_guesses, guesses))
+  answer_array = _ints(_lookup_all(_LIB.wordlitzer_lookup_answers, answers))
+  scores = (ctypes.c_double * len(guesses))()
+  _check(_LIB.wordlitzer_score_guesses(guess_array, len(guesses),
+                                       answer_array, len(answers), scores))
+  return list(scores)
+
+
+def score_guesses_batch(guesses, subsets):
+  """Like score_guesses for several answer lists at once, in one pass.
+
+  Returns a list of scores per subset."""
+  guess_array = _ints(_lookup_all(_LIB.wordlitzer_lookup_guesses, guesses))
+  answer_array = _ints(_lookup_all(_LIB.wordlitzer_lookup_answers,
+                                   [a for answers in subsets for a in answers]))
+  scores = (ctypes.c_double * (len(guesses) * len(subsets)))()
+  _check(_LIB.wordlitzer_score_guesses_batch(
+    guess_array, len(guesses), answer_array,
+    _ints([len(answers) for answers in subsets]), len(subsets), scores))
+  return [list(scores[i * len(guesses):(i + 1) * len(guesses)])
+          for i in range(len(subsets))]
+
+
+def solve(outcomes, max_depth=3):
+  """Returns (best guess, expected further steps), or None if no
+  answer fits the outcomes."""
+  if not filter_answers(outcomes):
+    return None
+  score = ctypes.c_double()
+  guess = _check(_LIB.wordlitzer_solve(*_outcome_arrays(outcomes), max_depth,
+                                       ctypes.byref(score)))
+  return _LIB.wordlitzer_guess(guess).decode(), score.value